@@ -48,6 +48,14 @@ android {
             resValue("mipmap", "app_icon", "@mipmap/ic_launcher_debug")
             resValue("mipmap", "app_icon_round", "@mipmap/ic_launcher_round_debug")
             resValue("string", "app_name", "@string/app_name_debug")
+
+            @Suppress("UnstableApiUsage")
+            externalNativeBuild {
+                cmake {
+                    // jni of instrumented tests
+                    targets("native-test")
+                }
+            }
         }
     }
 
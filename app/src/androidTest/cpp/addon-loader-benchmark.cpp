@@ -0,0 +1,69 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <fcitx-utils/standardpath.h>
+#include <fcitx-utils/stringutils.h>
+
+#include "androidaddonloader/androidaddonloader.h"
+#include "jni-utils.h"
+
+namespace {
+
+jobjectArray toJStringArray(JNIEnv *env, const std::vector<std::string> &strings) {
+    jclass stringClass = env->FindClass("java/lang/String");
+    jobjectArray array = env->NewObjectArray(static_cast<int>(strings.size()), stringClass, nullptr);
+    env->DeleteLocalRef(stringClass);
+    for (size_t i = 0; i < strings.size(); i++) {
+        env->SetObjectArrayElement(array, static_cast<int>(i), JString(env, strings[i]));
+    }
+    return array;
+}
+
+/**
+ * paths of every file in `files`, joined by ':', found by `locate`
+ */
+template<typename Locate>
+jobjectArray locateEach(JNIEnv *env, jobjectArray files, Locate &&locate) {
+    const int size = env->GetArrayLength(files);
+    std::vector<std::string> result;
+    result.reserve(size);
+    for (int i = 0; i < size; i++) {
+        auto file = JRef<jstring>(env, env->GetObjectArrayElement(files, i));
+        result.push_back(fcitx::stringutils::join(locate(CString(env, file)), ":"));
+    }
+    return toJStringArray(env, result);
+}
+
+}
+
+/**
+ * library lookup of the addon loader before it indexed addon directories:
+ * StandardPath::locateAll, which stats the file in every directory, for every library
+ */
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+Java_org_fcitx_fcitx5_android_AddonLoaderBenchmark_locateStandardPath(JNIEnv *env, jclass clazz, jstring addonDirs, jobjectArray files) {
+    setenv("FCITX_ADDON_DIRS", CString(env, addonDirs), 1);
+    fcitx::StandardPath standardPath;
+    return locateEach(env, files, [&](const std::string &file) {
+        return standardPath.locateAll(fcitx::StandardPath::Type::Addon, file);
+    });
+}
+
+/**
+ * construct the loader, which lists every addon directory once, then look up from its index
+ */
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+Java_org_fcitx_fcitx5_android_AddonLoaderBenchmark_locateIndexed(JNIEnv *env, jclass clazz, jstring addonDirs, jobjectArray files) {
+    setenv("FCITX_ADDON_DIRS", CString(env, addonDirs), 1);
+    fcitx::AndroidSharedLibraryLoader loader({});
+    return locateEach(env, files, [&](const std::string &file) {
+        return loader.locate(file);
+    });
+}
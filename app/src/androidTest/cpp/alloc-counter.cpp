@@ -0,0 +1,42 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#include <cstdlib>
+#include <new>
+
+#include "alloc-counter.h"
+
+static thread_local size_t allocations = 0;
+
+size_t allocationCount() {
+    return allocations;
+}
+
+void *operator new(size_t size) {
+    allocations++;
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    std::free(p);
+}
@@ -0,0 +1,16 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef FCITX5_ANDROID_ALLOC_COUNTER_H
+#define FCITX5_ANDROID_ALLOC_COUNTER_H
+
+#include <cstddef>
+
+/**
+ * @return number of times operator new has been called on current thread by code compiled into native-test,
+ * allocations made inside libc++_shared or other libraries are not seen
+ */
+size_t allocationCount();
+
+#endif //FCITX5_ANDROID_ALLOC_COUNTER_H
@@ -0,0 +1,129 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#include <jni.h>
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "async-log-sink.h"
+
+/**
+ * Lines written by AsyncLogSink, split at '\n', instead of going to logcat.
+ * Run with a sanitizer (-fsanitize=thread on host, or a HWASan build on device) to check for races.
+ */
+namespace {
+
+std::mutex recordMutex;
+std::vector<std::pair<int, std::string>> records;
+
+int recordWrite(int prio, const char *tag, const char *text) {
+    std::lock_guard<std::mutex> lock(recordMutex);
+    const std::string batch(text);
+    size_t start = 0;
+    for (;;) {
+        const auto end = batch.find('\n', start);
+        records.emplace_back(prio, batch.substr(start, end - start));
+        if (end == std::string::npos) {
+            return 0;
+        }
+        start = end + 1;
+    }
+}
+
+std::vector<std::pair<int, std::string>> takeRecords() {
+    std::lock_guard<std::mutex> lock(recordMutex);
+    return std::move(records);
+}
+
+}
+
+/**
+ * `threads` threads write `lines` lines each, as fast as they can
+ * @return [accepted, delivered, rejected, reported as dropped, out of order]
+ */
+extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_org_fcitx_fcitx5_android_AsyncLogSinkTest_stress(JNIEnv *env, jclass clazz, jint threads, jint lines) {
+    takeRecords();
+    std::vector<long> accepted(threads);
+    uint64_t rejected;
+    {
+        AsyncLogSink sink("test", &recordWrite);
+        std::vector<std::thread> producers;
+        for (int t = 0; t < threads; t++) {
+            producers.emplace_back([&, t]() {
+                char line[32];
+                for (int i = 0; i < lines; i++) {
+                    std::snprintf(line, sizeof(line), "%d %d", t, i);
+                    if (sink.write(i % 2 ? ANDROID_LOG_DEBUG : ANDROID_LOG_INFO, line)) {
+                        accepted[t]++;
+                    }
+                }
+            });
+        }
+        for (auto &producer: producers) {
+            producer.join();
+        }
+        rejected = sink.dropped();
+        // destructor drains what is left
+    }
+    long delivered = 0;
+    long reported = 0;
+    long outOfOrder = 0;
+    std::vector<int> last(threads, -1);
+    for (const auto &[prio, text]: takeRecords()) {
+        unsigned long count;
+        if (std::sscanf(text.c_str(), "Dropped %lu log lines", &count) == 1) {
+            reported += static_cast<long>(count);
+            continue;
+        }
+        int t;
+        int i;
+        if (std::sscanf(text.c_str(), "%d %d", &t, &i) != 2 || t < 0 || t >= threads) {
+            outOfOrder++;
+            continue;
+        }
+        if (i <= last[t] || prio != (i % 2 ? ANDROID_LOG_DEBUG : ANDROID_LOG_INFO)) {
+            outOfOrder++;
+        }
+        last[t] = i;
+        delivered++;
+    }
+    long acceptedTotal = 0;
+    for (const auto a: accepted) {
+        acceptedTotal += a;
+    }
+    const jlong result[] = {acceptedTotal, delivered, static_cast<jlong>(rejected), reported, outOfOrder};
+    jlongArray array = env->NewLongArray(5);
+    env->SetLongArrayRegion(array, 0, 5, result);
+    return array;
+}
+
+/**
+ * write `lines` lines, then a fatal line right away, while the drain thread may still be sleeping
+ * @return number of lines written before the fatal line, -1 if the fatal line is missing
+ */
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_org_fcitx_fcitx5_android_AsyncLogSinkTest_linesBeforeFatal(JNIEnv *env, jclass clazz, jint lines) {
+    takeRecords();
+    {
+        AsyncLogSink sink("test", &recordWrite);
+        for (int i = 0; i < lines; i++) {
+            sink.write(ANDROID_LOG_INFO, std::to_string(i).c_str());
+        }
+        sink.write(ANDROID_LOG_FATAL, "fatal");
+    }
+    const auto written = takeRecords();
+    for (size_t i = 0; i < written.size(); i++) {
+        if (written[i].first == ANDROID_LOG_FATAL) {
+            return static_cast<jlong>(i);
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,159 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#include <string>
+
+#include <fcitx-config/rawconfig.h>
+
+#include "flat-config.h"
+#include "jni-utils.h"
+
+/**
+ * GlobalRef lives in native-lib, so this library looks up what it needs by itself
+ */
+static struct {
+    jclass RawConfig;
+    jmethodID RawConfigInit;
+    jmethodID RawConfigSetSubItems;
+    jmethodID RawConfigFromFlat;
+    jfieldID RawConfigName;
+    jfieldID RawConfigValue;
+    jfieldID RawConfigSubItems;
+} Ref;
+
+static fcitx::RawConfig syntheticConfig;
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_org_fcitx_fcitx5_android_ConfigTransferBenchmark_prepare(JNIEnv *env, jclass clazz, jint groups, jint options) {
+    if (!Ref.RawConfig) {
+        jclass c = env->FindClass("org/fcitx/fcitx5/android/core/RawConfig");
+        Ref.RawConfig = reinterpret_cast<jclass>(env->NewGlobalRef(c));
+        env->DeleteLocalRef(c);
+        Ref.RawConfigInit = env->GetMethodID(Ref.RawConfig, "<init>", "(Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;[Lorg/fcitx/fcitx5/android/core/RawConfig;)V");
+        Ref.RawConfigSetSubItems = env->GetMethodID(Ref.RawConfig, "setSubItems", "([Lorg/fcitx/fcitx5/android/core/RawConfig;)V");
+        Ref.RawConfigFromFlat = env->GetStaticMethodID(Ref.RawConfig, "fromFlat", "([I[B)Lorg/fcitx/fcitx5/android/core/RawConfig;");
+        Ref.RawConfigName = env->GetFieldID(Ref.RawConfig, "name", "Ljava/lang/String;");
+        Ref.RawConfigValue = env->GetFieldID(Ref.RawConfig, "value", "Ljava/lang/String;");
+        Ref.RawConfigSubItems = env->GetFieldID(Ref.RawConfig, "subItems", "[Lorg/fcitx/fcitx5/android/core/RawConfig;");
+    }
+    // shaped like a config description: a group per option type, each option with a handful of attributes
+    syntheticConfig = fcitx::RawConfig();
+    for (int g = 0; g < groups; g++) {
+        const auto group = syntheticConfig.get("Group" + std::to_string(g), true);
+        for (int o = 0; o < options; o++) {
+            const auto option = group->get("Option" + std::to_string(o), true);
+            option->setComment("Comment of option " + std::to_string(o));
+            option->setValueByPath("Type", "Enum");
+            option->setValueByPath("Description", "Description of option " + std::to_string(o));
+            option->setValueByPath("DefaultValue", "Value" + std::to_string(o % 4));
+            for (int e = 0; e < 4; e++) {
+                option->setValueByPath("Enum/" + std::to_string(e), "Value" + std::to_string(e));
+                option->setValueByPath("EnumI18n/" + std::to_string(e), "值 " + std::to_string(e));
+            }
+        }
+    }
+    return static_cast<jint>(flattenRawConfig(syntheticConfig).size());
+}
+
+/**
+ * fcitxRawConfigToJObject before FlatConfig: one NewObject and one array per node
+ */
+static jobject rawConfigToJObject(JNIEnv *env, const fcitx::RawConfig &cfg) {
+    jobject obj = env->NewObject(Ref.RawConfig, Ref.RawConfigInit,
+                                 *JString(env, cfg.name()),
+                                 *JString(env, cfg.comment()),
+                                 *JString(env, cfg.value()),
+                                 nullptr);
+    if (!cfg.hasSubItems()) {
+        return obj;
+    }
+    auto array = JRef<jobjectArray>(env, env->NewObjectArray(static_cast<int>(cfg.subItemsSize()), Ref.RawConfig, nullptr));
+    int i = 0;
+    for (const auto &item: cfg.subItems()) {
+        auto jItem = JRef(env, rawConfigToJObject(env, *cfg.get(item)));
+        env->SetObjectArrayElement(array, i++, jItem);
+    }
+    env->CallVoidMethod(obj, Ref.RawConfigSetSubItems, *array);
+    return obj;
+}
+
+/**
+ * jobjectFillRawConfig before FlatConfig: reads fields of every node through JNI
+ */
+static void fillRawConfigFromJObject(JNIEnv *env, jobject jConfig, fcitx::RawConfig &config) {
+    auto subItems = JRef<jobjectArray>(env, env->GetObjectField(jConfig, Ref.RawConfigSubItems));
+    if (*subItems == nullptr) {
+        auto value = JRef<jstring>(env, env->GetObjectField(jConfig, Ref.RawConfigValue));
+        config = CString(env, value);
+    } else {
+        int size = env->GetArrayLength(subItems);
+        for (int i = 0; i < size; i++) {
+            auto item = JRef(env, env->GetObjectArrayElement(subItems, i));
+            auto name = JRef<jstring>(env, env->GetObjectField(item, Ref.RawConfigName));
+            auto subConfig = config.get(CString(env, name), true);
+            fillRawConfigFromJObject(env, item, *subConfig);
+        }
+    }
+}
+
+static bool sameAsSynthetic(const fcitx::RawConfig &config) {
+    const auto expected = flattenRawConfig(syntheticConfig);
+    const auto actual = flattenRawConfig(config);
+    return expected.nodes() == actual.nodes() && expected.pool() == actual.pool();
+}
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_org_fcitx_fcitx5_android_ConfigTransferBenchmark_toJObjectRecursive(JNIEnv *env, jclass clazz) {
+    return rawConfigToJObject(env, syntheticConfig);
+}
+
+/**
+ * same as flatConfigToJObject in object-conversion.h
+ */
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_org_fcitx_fcitx5_android_ConfigTransferBenchmark_toJObjectFlat(JNIEnv *env, jclass clazz) {
+    const auto flat = flattenRawConfig(syntheticConfig);
+    const auto &nodes = flat.nodes();
+    const auto &pool = flat.pool();
+    auto jNodes = JRef<jintArray>(env, env->NewIntArray(static_cast<int>(nodes.size())));
+    env->SetIntArrayRegion(jNodes, 0, static_cast<int>(nodes.size()), nodes.data());
+    auto jPool = JRef<jbyteArray>(env, env->NewByteArray(static_cast<int>(pool.size())));
+    env->SetByteArrayRegion(jPool, 0, static_cast<int>(pool.size()), reinterpret_cast<const jbyte *>(pool.data()));
+    return env->CallStaticObjectMethod(Ref.RawConfig, Ref.RawConfigFromFlat, *jNodes, *jPool);
+}
+
+/**
+ * @return whether the config read back equals the one from prepare()
+ */
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_org_fcitx_fcitx5_android_ConfigTransferBenchmark_fromJObjectRecursive(JNIEnv *env, jclass clazz, jobject config) {
+    fcitx::RawConfig result;
+    fillRawConfigFromJObject(env, config, result);
+    return sameAsSynthetic(result);
+}
+
+/**
+ * same as flatConfigArraysToRawConfig in object-conversion.h
+ * @return whether the config read back equals the one from prepare()
+ */
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_org_fcitx_fcitx5_android_ConfigTransferBenchmark_fromFlat(JNIEnv *env, jclass clazz, jintArray nodes, jbyteArray pool) {
+    std::vector<int32_t> nodesVector(env->GetArrayLength(nodes));
+    env->GetIntArrayRegion(nodes, 0, static_cast<int>(nodesVector.size()), nodesVector.data());
+    std::string poolString(env->GetArrayLength(pool), '\0');
+    env->GetByteArrayRegion(pool, 0, static_cast<int>(poolString.size()), reinterpret_cast<jbyte *>(poolString.data()));
+    try {
+        fcitx::RawConfig result;
+        fillRawConfig(FlatConfig(std::move(nodesVector), std::move(poolString)), result);
+        return sameAsSynthetic(result);
+    } catch (const std::exception &e) {
+        throwJavaException(env, e.what());
+        return JNI_FALSE;
+    }
+}
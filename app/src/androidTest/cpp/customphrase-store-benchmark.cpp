@@ -0,0 +1,103 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#include <fstream>
+
+#include "customphrase-store.h"
+#include "jni-utils.h"
+
+/**
+ * CustomPhraseManager.save before the edit journal: marshal every phrase from Java,
+ * then write all of them to the text file
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_org_fcitx_fcitx5_android_CustomPhraseStoreBenchmark_saveAll(JNIEnv *env, jclass clazz, jobjectArray items, jstring textPath) {
+    jclass phraseClass = env->FindClass("org/fcitx/fcitx5/android/data/pinyin/customphrase/PinyinCustomPhrase");
+    const auto keyField = env->GetFieldID(phraseClass, "key", "Ljava/lang/String;");
+    const auto orderField = env->GetFieldID(phraseClass, "order", "I");
+    const auto valueField = env->GetFieldID(phraseClass, "value", "Ljava/lang/String;");
+    env->DeleteLocalRef(phraseClass);
+    fcitx::CustomPhraseDict dict;
+    const int size = env->GetArrayLength(items);
+    for (int i = 0; i < size; i++) {
+        auto phrase = JRef(env, env->GetObjectArrayElement(items, i));
+        auto key = JRef<jstring>(env, env->GetObjectField(phrase, keyField));
+        auto value = JRef<jstring>(env, env->GetObjectField(phrase, valueField));
+        dict.addPhrase(*CString(env, key), *CString(env, value), env->GetIntField(phrase, orderField));
+    }
+    std::ofstream out(*CString(env, textPath), std::ios::out | std::ios::binary | std::ios::trunc);
+    dict.save(out);
+}
+
+/**
+ * import the text file into a new store, like the first open of the editor
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_org_fcitx_fcitx5_android_CustomPhraseStoreBenchmark_importText(JNIEnv *env, jclass clazz, jstring storePath, jstring textPath) {
+    try {
+        CustomPhraseStore store(CString(env, storePath));
+        store.open();
+        const std::string path = CString(env, textPath);
+        uint64_t mtime;
+        uint64_t size;
+        CustomPhraseStore::textStamp(path, mtime, size);
+        std::ifstream in(path, std::ios::in | std::ios::binary);
+        store.importText(in, mtime, size);
+    } catch (const std::exception &e) {
+        throwJavaException(env, e.what());
+    }
+}
+
+/**
+ * one save of the editor with the edit journal: open the store, add a phrase, and commit
+ * @return id of the new phrase
+ */
+extern "C"
+JNIEXPORT jint JNICALL
+Java_org_fcitx_fcitx5_android_CustomPhraseStoreBenchmark_addAndCommit(JNIEnv *env, jclass clazz, jstring storePath, jstring textPath, jstring key, jstring value) {
+    try {
+        CustomPhraseStore store(CString(env, storePath));
+        store.open();
+        const auto id = store.add(*CString(env, key), 1, *CString(env, value));
+        store.commitText(CString(env, textPath));
+        return static_cast<jint>(id);
+    } catch (const std::exception &e) {
+        throwJavaException(env, e.what());
+        return -1;
+    }
+}
+
+/**
+ * like addAndCommit, but removing a phrase, which rewrites the text file
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_org_fcitx_fcitx5_android_CustomPhraseStoreBenchmark_removeAndCommit(JNIEnv *env, jclass clazz, jstring storePath, jstring textPath, jint id) {
+    try {
+        CustomPhraseStore store(CString(env, storePath));
+        store.open();
+        store.remove(static_cast<uint32_t>(id));
+        store.commitText(CString(env, textPath));
+    } catch (const std::exception &e) {
+        throwJavaException(env, e.what());
+    }
+}
+
+/**
+ * @return number of phrases the pinyin addon would read from the text file
+ */
+extern "C"
+JNIEXPORT jint JNICALL
+Java_org_fcitx_fcitx5_android_CustomPhraseStoreBenchmark_countText(JNIEnv *env, jclass clazz, jstring textPath) {
+    std::ifstream in(*CString(env, textPath), std::ios::in | std::ios::binary);
+    fcitx::CustomPhraseDict dict;
+    dict.load(in, true);
+    int count = 0;
+    dict.foreach([&](const std::string &, std::vector<fcitx::CustomPhrase> &items) {
+        count += static_cast<int>(items.size());
+    });
+    return count;
+}
@@ -0,0 +1,78 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#include <jni.h>
+
+#include <string>
+#include <vector>
+
+#include "alloc-counter.h"
+#include "androidkeyboard/fixedinputbuffer.h"
+
+// keep results alive, so that the compiler cannot drop the work being measured
+static volatile size_t sink;
+
+static size_t utf8Length(unsigned char lead) {
+    return lead < 0x80 ? 1 : lead < 0xe0 ? 2 : lead < 0xf0 ? 3 : 4;
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_org_fcitx_fcitx5_android_FixedInputBufferTest_controlAllocations(JNIEnv *env, jclass clazz) {
+    const auto before = allocationCount();
+    auto *p = new int[16];
+    sink = reinterpret_cast<size_t>(p);
+    delete[] p;
+    std::vector<int> v(16);
+    sink = reinterpret_cast<size_t>(v.data());
+    return static_cast<jlong>(allocationCount() - before);
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_org_fcitx_fcitx5_android_FixedInputBufferTest_typingAllocations(JNIEnv *env, jclass clazz, jobjectArray words) {
+    // copy words out of JVM first, only the key strokes are measured
+    std::vector<std::string> input;
+    const int size = env->GetArrayLength(words);
+    input.reserve(size);
+    for (int i = 0; i < size; i++) {
+        auto *word = static_cast<jstring>(env->GetObjectArrayElement(words, i));
+        const char *chars = env->GetStringUTFChars(word, nullptr);
+        input.emplace_back(chars);
+        env->ReleaseStringUTFChars(word, chars);
+        env->DeleteLocalRef(word);
+    }
+    // same capacity as AndroidKeyboardMaxBufferSize
+    fcitx::FixedInputBuffer<20> buffer;
+    size_t checksum = 0;
+    const auto before = allocationCount();
+    for (const auto &word: input) {
+        // one character per key stroke, like AndroidKeyboardEngine::updateBuffer
+        for (size_t i = 0; i < word.size();) {
+            const auto length = utf8Length(static_cast<unsigned char>(word[i]));
+            if (!buffer.type(std::string_view(word).substr(i, length))) {
+                if (buffer.empty()) {
+                    // malformed, skip it
+                    i += length;
+                } else {
+                    // full, androidkeyboard would commit here
+                    checksum += buffer.userInput().size();
+                    buffer.clear();
+                }
+                continue;
+            }
+            checksum += buffer.userInput().size() + buffer.cursorByChar();
+            i += length;
+        }
+        buffer.setCursor(0);
+        buffer.del();
+        buffer.setCursor(buffer.size());
+        buffer.backspace();
+        checksum += buffer.userInput().size() + buffer.cursorByChar();
+        buffer.clear();
+    }
+    const auto after = allocationCount();
+    sink = checksum;
+    return static_cast<jlong>(after - before);
+}
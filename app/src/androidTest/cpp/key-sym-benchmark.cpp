@@ -0,0 +1,79 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#include <vector>
+
+#include "alloc-counter.h"
+#include "key-sym-conversion.h"
+
+namespace {
+
+std::vector<jstring> keyRefs(JNIEnv *env, jobjectArray keys) {
+    const int size = env->GetArrayLength(keys);
+    std::vector<jstring> refs(size);
+    for (int i = 0; i < size; i++) {
+        refs[i] = static_cast<jstring>(env->GetObjectArrayElement(keys, i));
+    }
+    return refs;
+}
+
+/**
+ * resolve every key `rounds` times
+ * @return keysyms of the last round
+ */
+template<typename Resolve>
+jintArray resolveKeys(JNIEnv *env, jobjectArray keys, jint rounds, Resolve &&resolve) {
+    const auto refs = keyRefs(env, keys);
+    std::vector<jint> syms(refs.size());
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < refs.size(); i++) {
+            syms[i] = static_cast<jint>(resolve(refs[i]));
+        }
+    }
+    for (auto ref: refs) {
+        env->DeleteLocalRef(ref);
+    }
+    jintArray result = env->NewIntArray(static_cast<int>(syms.size()));
+    env->SetIntArrayRegion(result, 0, static_cast<int>(syms.size()), syms.data());
+    return result;
+}
+
+}
+
+/**
+ * sendKeyToFcitxString before the key name table: copy to modified UTF-8, then keySymFromString
+ */
+extern "C"
+JNIEXPORT jintArray JNICALL
+Java_org_fcitx_fcitx5_android_KeySymBenchmark_resolveWithCString(JNIEnv *env, jclass clazz, jobjectArray keys, jint rounds) {
+    return resolveKeys(env, keys, rounds, [env](jstring key) {
+        return fcitx::Key::keySymFromString(CString(env, key));
+    });
+}
+
+extern "C"
+JNIEXPORT jintArray JNICALL
+Java_org_fcitx_fcitx5_android_KeySymBenchmark_resolveWithJString(JNIEnv *env, jclass clazz, jobjectArray keys, jint rounds) {
+    return resolveKeys(env, keys, rounds, [env](jstring key) {
+        return keySymFromJString(env, key);
+    });
+}
+
+/**
+ * @return times operator new has been called by keySymFromJString, resolving every key once
+ */
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_org_fcitx_fcitx5_android_KeySymBenchmark_jstringAllocations(JNIEnv *env, jclass clazz, jobjectArray keys) {
+    const auto refs = keyRefs(env, keys);
+    const auto before = allocationCount();
+    for (auto ref: refs) {
+        keySymFromJString(env, ref);
+    }
+    const auto count = allocationCount() - before;
+    for (auto ref: refs) {
+        env->DeleteLocalRef(ref);
+    }
+    return static_cast<jlong>(count);
+}
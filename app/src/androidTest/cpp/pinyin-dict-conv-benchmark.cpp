@@ -0,0 +1,28 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#include <fstream>
+
+#include <libime/pinyin/pinyindictionary.h>
+
+#include "jni-utils.h"
+
+/**
+ * pinyinDictConv before it streamed text across worker threads:
+ * load the whole dictionary, then save it, all on the calling thread
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_org_fcitx_fcitx5_android_PinyinDictConvBenchmark_loadAndSave(JNIEnv *env, jclass clazz, jstring src, jstring dest) {
+    using namespace libime;
+    PinyinDictionary dict;
+    try {
+        dict.load(PinyinDictionary::SystemDict, *CString(env, src), PinyinDictFormat::Text);
+        std::ofstream out;
+        out.open(*CString(env, dest), std::ios::out | std::ios::binary);
+        dict.save(PinyinDictionary::SystemDict, out, PinyinDictFormat::Binary);
+    } catch (const std::exception &e) {
+        throwJavaException(env, e.what());
+    }
+}
@@ -0,0 +1,28 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#include <fstream>
+
+#include <libime/table/tablebaseddictionary.h>
+
+#include "jni-utils.h"
+
+/**
+ * tableDictConv before it streamed through DictConvSource and DictConvSink:
+ * load and save through the file path and std::ofstream
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_org_fcitx_fcitx5_android_TableDictConvBenchmark_loadAndSave(JNIEnv *env, jclass clazz, jstring src, jstring dest) {
+    using namespace libime;
+    TableBasedDictionary dict;
+    try {
+        dict.load(*CString(env, src), TableFormat::Text);
+        std::ofstream out;
+        out.open(*CString(env, dest), std::ios::out | std::ios::binary);
+        dict.save(out, TableFormat::Binary);
+    } catch (const std::exception &e) {
+        throwJavaException(env, e.what());
+    }
+}
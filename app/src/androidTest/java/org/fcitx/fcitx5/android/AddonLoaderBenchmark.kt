@@ -0,0 +1,72 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+package org.fcitx.fcitx5.android
+
+import androidx.test.platform.app.InstrumentationRegistry
+import org.junit.After
+import org.junit.Assert
+import org.junit.Before
+import org.junit.BeforeClass
+import org.junit.Test
+import java.io.File
+
+class AddonLoaderBenchmark {
+
+    companion object {
+        @BeforeClass
+        @JvmStatic
+        fun setup() {
+            System.loadLibrary("native-lib")
+            System.loadLibrary("native-test")
+        }
+
+        @JvmStatic
+        external fun locateStandardPath(addonDirs: String, files: Array<String>): Array<String>
+
+        @JvmStatic
+        external fun locateIndexed(addonDirs: String, files: Array<String>): Array<String>
+
+        private const val PluginCount = 12
+        private const val LibrariesPerPlugin = 6
+    }
+
+    private lateinit var dir: File
+
+    @Before
+    fun createDir() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        dir = File(context.cacheDir, "addon-loader-benchmark").also { it.mkdirs() }
+    }
+
+    @After
+    fun deleteDir() {
+        dir.deleteRecursively()
+    }
+
+    @Test
+    fun benchmarkLocate() {
+        // native library dir of the app, then one per plugin, like FCITX_ADDON_DIRS at startup
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        val dirs = listOf(File(context.applicationInfo.nativeLibraryDir)) + (0 until PluginCount).map { i ->
+            File(dir, "plugin$i").also { pluginDir ->
+                pluginDir.mkdirs()
+                repeat(LibrariesPerPlugin) { j -> File(pluginDir, "libplugin${i}_$j.so").createNewFile() }
+            }
+        }
+        val addonDirs = dirs.joinToString(":") { it.absolutePath }
+        // every library of the app and plugins, and dependencies that are not shipped;
+        // native library dir may not exist at all when libraries are kept in the apk
+        val files = (dirs.flatMap { d -> d.list { _, name -> name.endsWith(".so") }.orEmpty().toList() } +
+                (0 until PluginCount).map { "libmissing$it.so" }).toTypedArray()
+        Assert.assertArrayEquals(locateStandardPath(addonDirs, files), locateIndexed(addonDirs, files))
+        val standardPath = Benchmark.nanosPerCall(20) { locateStandardPath(addonDirs, files) }
+        val indexed = Benchmark.nanosPerCall(20) { locateIndexed(addonDirs, files) }
+        Benchmark.report(
+            "locate ${files.size} libraries in ${dirs.size} directories",
+            "StandardPath.locateAll" to "${standardPath / 1000} us",
+            "loader index, including construction" to "${indexed / 1000} us"
+        )
+    }
+}
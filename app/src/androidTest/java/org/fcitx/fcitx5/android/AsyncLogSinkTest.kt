@@ -0,0 +1,50 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+package org.fcitx.fcitx5.android
+
+import org.junit.Assert
+import org.junit.BeforeClass
+import org.junit.Test
+
+class AsyncLogSinkTest {
+
+    private companion object {
+        @BeforeClass
+        @JvmStatic
+        fun setup() {
+            System.loadLibrary("native-test")
+        }
+
+        /**
+         * @return [accepted, delivered, rejected, reported as dropped, out of order]
+         */
+        @JvmStatic
+        external fun stress(threads: Int, lines: Int): LongArray
+
+        @JvmStatic
+        external fun linesBeforeFatal(lines: Int): Long
+
+        // same as AsyncLogSink::Capacity
+        private const val Capacity = 512
+    }
+
+    @Test
+    fun testEveryLineIsDeliveredOrCounted() {
+        for (threads in intArrayOf(1, 4, 8)) {
+            val (accepted, delivered, rejected, reported, outOfOrder) = stress(threads, 20_000).toList()
+            Assert.assertEquals(accepted, delivered)
+            Assert.assertEquals(rejected, reported)
+            Assert.assertEquals(threads * 20_000L, accepted + rejected)
+            Assert.assertEquals(0L, outOfOrder)
+        }
+    }
+
+    @Test
+    fun testFatalLineComesAfterQueuedLines() {
+        for (lines in intArrayOf(0, 10, Capacity - 1)) {
+            Assert.assertEquals(lines.toLong(), linesBeforeFatal(lines))
+        }
+    }
+}
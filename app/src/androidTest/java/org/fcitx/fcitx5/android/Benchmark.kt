@@ -0,0 +1,65 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+package org.fcitx.fcitx5.android
+
+import android.os.SystemClock
+import android.util.Log
+import java.io.File
+
+/**
+ * Timing and memory measurement for benchmarks in instrumented tests, results go to logcat
+ */
+object Benchmark {
+
+    private const val TAG = "Benchmark"
+
+    /**
+     * @param peakRssKb peak resident set size of the process while running, -1 if unavailable
+     */
+    data class Result(val millis: Long, val peakRssKb: Long) {
+        override fun toString() =
+            if (peakRssKb < 0) "$millis ms" else "$millis ms, peak RSS ${peakRssKb / 1024} MiB"
+    }
+
+    fun measure(block: () -> Unit): Result {
+        System.gc()
+        val peakAvailable = resetPeakRss()
+        val start = SystemClock.elapsedRealtime()
+        block()
+        val millis = SystemClock.elapsedRealtime() - start
+        return Result(millis, if (peakAvailable) peakRssKb() else -1)
+    }
+
+    /**
+     * @return median of nanoseconds per call of [block], over [rounds] rounds of [calls] calls
+     */
+    fun nanosPerCall(calls: Int, rounds: Int = 9, block: () -> Unit): Double {
+        // warm up
+        repeat(calls) { block() }
+        val samples = DoubleArray(rounds) {
+            val start = System.nanoTime()
+            repeat(calls) { block() }
+            (System.nanoTime() - start).toDouble() / calls
+        }
+        samples.sort()
+        return samples[rounds / 2]
+    }
+
+    fun report(name: String, vararg results: Pair<String, Any>) {
+        Log.i(TAG, "$name: " + results.joinToString { (label, result) -> "$label: $result" })
+    }
+
+    // writing "5" to clear_refs resets VmHWM, see proc(5)
+    private fun resetPeakRss() = try {
+        File("/proc/self/clear_refs").writeText("5")
+        true
+    } catch (e: Exception) {
+        false
+    }
+
+    private fun peakRssKb() = File("/proc/self/status").useLines { lines ->
+        lines.first { it.startsWith("VmHWM:") }.split(Regex("\\s+"))[1].toLong()
+    }
+}
@@ -0,0 +1,84 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+package org.fcitx.fcitx5.android
+
+import org.fcitx.fcitx5.android.core.RawConfig
+import org.junit.Assert
+import org.junit.BeforeClass
+import org.junit.Test
+
+class ConfigTransferBenchmark {
+
+    companion object {
+        @BeforeClass
+        @JvmStatic
+        fun setup() {
+            System.loadLibrary("native-lib")
+            System.loadLibrary("native-test")
+        }
+
+        /**
+         * build a synthetic config on native side
+         * @return number of nodes
+         */
+        @JvmStatic
+        external fun prepare(groups: Int, options: Int): Int
+
+        @JvmStatic
+        external fun toJObjectRecursive(): RawConfig
+
+        @JvmStatic
+        external fun toJObjectFlat(): RawConfig
+
+        @JvmStatic
+        external fun fromJObjectRecursive(config: RawConfig): Boolean
+
+        @JvmStatic
+        external fun fromFlat(nodes: IntArray, pool: ByteArray): Boolean
+
+        /**
+         * (groups, options per group): about the size of the config description of pinyin,
+         * and several times that, for the largest configs users may have
+         */
+        private val Sizes = listOf(8 to 16, 32 to 32, 64 to 64)
+    }
+
+    @Test
+    fun benchmarkToJObject() {
+        Sizes.forEach { (groups, options) ->
+            val nodes = prepare(groups, options)
+            Assert.assertEquals(toJObjectRecursive(), toJObjectFlat())
+            val calls = maxOf(1, 20_000 / nodes)
+            Benchmark.report(
+                "RawConfig to Java, $nodes nodes",
+                "recursive" to "${Benchmark.nanosPerCall(calls) { toJObjectRecursive() } / 1000} us",
+                "flat" to "${Benchmark.nanosPerCall(calls) { toJObjectFlat() } / 1000} us"
+            )
+        }
+    }
+
+    @Test
+    fun benchmarkFromJObject() {
+        Sizes.forEach { (groups, options) ->
+            val nodes = prepare(groups, options)
+            val config = toJObjectFlat()
+            Assert.assertTrue(fromJObjectRecursive(config))
+            val (flatNodes, flatPool) = config.flatten()
+            Assert.assertTrue(fromFlat(flatNodes, flatPool))
+            val calls = maxOf(1, 20_000 / nodes)
+            Benchmark.report(
+                "RawConfig from Java, $nodes nodes",
+                "recursive" to "${Benchmark.nanosPerCall(calls) { fromJObjectRecursive(config) } / 1000} us",
+                // flatten() is part of the cost, as in Fcitx.setGlobalConfig
+                "flat" to "${
+                    Benchmark.nanosPerCall(calls) {
+                        val (n, p) = config.flatten()
+                        fromFlat(n, p)
+                    } / 1000
+                } us"
+            )
+        }
+    }
+}
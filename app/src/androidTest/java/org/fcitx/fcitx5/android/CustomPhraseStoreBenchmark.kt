@@ -0,0 +1,101 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+package org.fcitx.fcitx5.android
+
+import androidx.test.platform.app.InstrumentationRegistry
+import org.fcitx.fcitx5.android.data.pinyin.customphrase.PinyinCustomPhrase
+import org.junit.After
+import org.junit.Assert
+import org.junit.Before
+import org.junit.BeforeClass
+import org.junit.Test
+import java.io.File
+
+class CustomPhraseStoreBenchmark {
+
+    companion object {
+        @BeforeClass
+        @JvmStatic
+        fun setup() {
+            System.loadLibrary("native-lib")
+            System.loadLibrary("native-test")
+        }
+
+        @JvmStatic
+        external fun saveAll(items: Array<PinyinCustomPhrase>, textPath: String)
+
+        @JvmStatic
+        external fun importText(storePath: String, textPath: String)
+
+        @JvmStatic
+        external fun addAndCommit(storePath: String, textPath: String, key: String, value: String): Int
+
+        @JvmStatic
+        external fun removeAndCommit(storePath: String, textPath: String, id: Int)
+
+        @JvmStatic
+        external fun countText(textPath: String): Int
+
+        private const val PhraseCount = 50_000
+
+        private const val Saves = 20
+
+        fun syntheticPhrases() = Array(PhraseCount) {
+            PinyinCustomPhrase("k${it % 5000}", it % 10 + 1, "phrase $it")
+        }
+    }
+
+    private lateinit var dir: File
+    private lateinit var text: File
+    private lateinit var store: File
+
+    @Before
+    fun createDir() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        dir = File(context.cacheDir, "customphrase-benchmark").also { it.mkdirs() }
+        text = File(dir, "customphrase")
+        store = File(dir, "customphrase.store")
+    }
+
+    @After
+    fun deleteDir() {
+        dir.deleteRecursively()
+    }
+
+    @Test
+    fun benchmarkSingleEdit() {
+        val phrases = syntheticPhrases()
+        saveAll(phrases, text.absolutePath)
+        importText(store.absolutePath, text.absolutePath)
+        // before: every save marshals the whole list and writes every phrase
+        var edited = phrases
+        val saveAll = Benchmark.measure {
+            repeat(Saves) {
+                edited += PinyinCustomPhrase("new", 1, "new $it")
+                saveAll(edited, text.absolutePath)
+            }
+        }
+        importText(store.absolutePath, text.absolutePath)
+        // after: adding a phrase appends it to the text file
+        val ids = IntArray(Saves)
+        val append = Benchmark.measure {
+            repeat(Saves) {
+                ids[it] = addAndCommit(store.absolutePath, text.absolutePath, "new", "appended $it")
+            }
+        }
+        Assert.assertEquals(PhraseCount + 2 * Saves, countText(text.absolutePath))
+        // removing one still rewrites the text file, but without marshalling
+        val rewrite = Benchmark.measure {
+            ids.forEach { removeAndCommit(store.absolutePath, text.absolutePath, it) }
+        }
+        Assert.assertEquals(PhraseCount + Saves, countText(text.absolutePath))
+        Benchmark.report(
+            "custom phrase, $Saves saves of $PhraseCount phrases",
+            "save all" to saveAll,
+            "journal, add" to append,
+            "journal, remove" to rewrite
+        )
+    }
+}
@@ -0,0 +1,41 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+package org.fcitx.fcitx5.android
+
+import org.junit.Assert
+import org.junit.BeforeClass
+import org.junit.Test
+
+class FixedInputBufferTest {
+
+    private companion object {
+        @BeforeClass
+        @JvmStatic
+        fun setup() {
+            System.loadLibrary("native-test")
+        }
+
+        @JvmStatic
+        external fun controlAllocations(): Long
+
+        @JvmStatic
+        external fun typingAllocations(words: Array<String>): Long
+    }
+
+    @Test
+    fun testAllocationsAreCounted() {
+        Assert.assertTrue(controlAllocations() > 0)
+    }
+
+    @Test
+    fun testTypingDoesNotAllocate() {
+        val words = arrayOf(
+            "hello", "world", "naïve", "你好世界", "🙂👍",
+            // longer than the buffer
+            "supercalifragilisticexpialidocious"
+        )
+        Assert.assertEquals(0L, typingAllocations(words))
+    }
+}
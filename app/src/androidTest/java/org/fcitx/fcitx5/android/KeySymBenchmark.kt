@@ -0,0 +1,75 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+package org.fcitx.fcitx5.android
+
+import org.junit.Assert
+import org.junit.BeforeClass
+import org.junit.Test
+
+class KeySymBenchmark {
+
+    companion object {
+        @BeforeClass
+        @JvmStatic
+        fun setup() {
+            System.loadLibrary("native-lib")
+            System.loadLibrary("native-test")
+        }
+
+        @JvmStatic
+        external fun resolveWithCString(keys: Array<String>, rounds: Int): IntArray
+
+        @JvmStatic
+        external fun resolveWithJString(keys: Array<String>, rounds: Int): IntArray
+
+        @JvmStatic
+        external fun jstringAllocations(keys: Array<String>): Long
+
+        private const val Rounds = 10_000
+
+        // what keyboard layouts send: letters, punctuation, CJK, emoji, and common key names
+        private val TypingKeys = arrayOf(
+            "a", "z", "A", "1", ",", ".", "é", "你", "🙂",
+            "space", "BackSpace", "Return", "comma", "period", "Shift_L", "Page_Down", "KP_Enter"
+        )
+
+        // names not in the table, which still go through keySymFromString
+        private val OtherKeys = arrayOf("XF86Copy", "dead_acute", "ISO_Left_Tab", "Hangul")
+    }
+
+    @Test
+    fun testSameKeySyms() {
+        // modified UTF-8 of CString encodes supplementary characters as two surrogates,
+        // which keySymFromString cannot decode, see testSupplementaryCharacter
+        val keys = (TypingKeys + OtherKeys).filter { it.codePointCount(0, it.length) == it.length }
+        Assert.assertArrayEquals(
+            resolveWithCString(keys.toTypedArray(), 1),
+            resolveWithJString(keys.toTypedArray(), 1)
+        )
+    }
+
+    @Test
+    fun testSupplementaryCharacter() {
+        // keySymFromUnicode maps code points beyond Latin-1 to 0x01000000 + code point
+        Assert.assertArrayEquals(intArrayOf(0x0101f642), resolveWithJString(arrayOf("🙂"), 1))
+    }
+
+    @Test
+    fun testTypingKeysDoNotAllocate() {
+        Assert.assertEquals(0L, jstringAllocations(TypingKeys))
+    }
+
+    @Test
+    fun benchmarkResolve() {
+        val calls = Rounds * TypingKeys.size
+        val cstring = Benchmark.nanosPerCall(1) { resolveWithCString(TypingKeys, Rounds) } / calls
+        val jstring = Benchmark.nanosPerCall(1) { resolveWithJString(TypingKeys, Rounds) } / calls
+        Benchmark.report(
+            "resolve key string, ${TypingKeys.size} keys x $Rounds",
+            "keySymFromString(CString)" to "$cstring ns/key",
+            "keySymFromJString" to "$jstring ns/key"
+        )
+    }
+}
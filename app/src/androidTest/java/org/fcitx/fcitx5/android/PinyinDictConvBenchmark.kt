@@ -0,0 +1,116 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+package org.fcitx.fcitx5.android
+
+import androidx.test.platform.app.InstrumentationRegistry
+import org.fcitx.fcitx5.android.data.pinyin.PinyinDictManager
+import org.junit.After
+import org.junit.Assert
+import org.junit.Before
+import org.junit.BeforeClass
+import org.junit.Test
+import java.io.File
+
+class PinyinDictConvBenchmark {
+
+    companion object {
+        @BeforeClass
+        @JvmStatic
+        fun setup() {
+            System.loadLibrary("native-lib")
+            System.loadLibrary("native-test")
+        }
+
+        @JvmStatic
+        external fun loadAndSave(src: String, dest: String)
+
+        private const val EntryCount = 1_000_000
+
+        private val Syllables = arrayOf(
+            "a", "ba", "ci", "de", "fa", "ge", "hu", "ji", "ka", "le",
+            "ma", "ni", "po", "qu", "ri", "si", "ta", "wu", "xi", "zhe"
+        )
+
+        /**
+         * Write [EntryCount] distinct three-character words in libime text format.
+         * Each character is one of 100 hanzi, so that every word is unique.
+         */
+        fun writeSyntheticDict(file: File) {
+            file.bufferedWriter().use { out ->
+                for (i in 0 until EntryCount) {
+                    val chars = intArrayOf(i / 10000, i / 100 % 100, i % 100)
+                    chars.forEach { out.write(0x4e00 + it) }
+                    out.write(" ")
+                    out.write(chars.joinToString("'") { Syllables[it % Syllables.size] })
+                    out.write(" -${i % 1000 / 100.0}\n")
+                }
+            }
+        }
+    }
+
+    private lateinit var dir: File
+
+    @Before
+    fun createDir() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        dir = File(context.cacheDir, "dict-conv-benchmark").also { it.mkdirs() }
+    }
+
+    @After
+    fun deleteDir() {
+        dir.deleteRecursively()
+    }
+
+    private fun textDump(bin: File): ByteArray {
+        val txt = File(dir, "${bin.nameWithoutExtension}.out.txt")
+        PinyinDictManager.pinyinDictConv(
+            bin.absolutePath,
+            txt.absolutePath,
+            PinyinDictManager.MODE_BIN_TO_TXT,
+            null
+        )
+        return txt.readBytes().also { txt.delete() }
+    }
+
+    @Test
+    fun benchmarkTextToBinary() {
+        val src = File(dir, "synthetic.txt").also { writeSyntheticDict(it) }
+        val loaded = File(dir, "loaded.dict")
+        val streamed = File(dir, "streamed.dict")
+        val loadResult = Benchmark.measure { loadAndSave(src.absolutePath, loaded.absolutePath) }
+        var reports = 0
+        val streamResult = Benchmark.measure {
+            PinyinDictManager.pinyinDictConv(
+                src.absolutePath,
+                streamed.absolutePath,
+                PinyinDictManager.MODE_TXT_TO_BIN
+            ) { _, _ ->
+                reports++
+                true
+            }
+        }
+        Benchmark.report(
+            "pinyinDictConv $EntryCount entries",
+            "load and save" to loadResult,
+            "streaming" to streamResult
+        )
+        Assert.assertTrue(reports > 0)
+        Assert.assertArrayEquals(textDump(loaded), textDump(streamed))
+    }
+
+    @Test
+    fun testCancel() {
+        val src = File(dir, "synthetic.txt").also { writeSyntheticDict(it) }
+        val dest = File(dir, "cancelled.dict")
+        val result = runCatching {
+            PinyinDictManager.pinyinDictConv(
+                src.absolutePath,
+                dest.absolutePath,
+                PinyinDictManager.MODE_TXT_TO_BIN
+            ) { processed, total -> processed < total / 2 }
+        }
+        Assert.assertTrue(result.isFailure)
+    }
+}
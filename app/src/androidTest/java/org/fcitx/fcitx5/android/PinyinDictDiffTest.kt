@@ -0,0 +1,99 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+package org.fcitx.fcitx5.android
+
+import androidx.test.platform.app.InstrumentationRegistry
+import org.fcitx.fcitx5.android.data.pinyin.PinyinDictManager
+import org.junit.After
+import org.junit.Assert
+import org.junit.Before
+import org.junit.BeforeClass
+import org.junit.Test
+import java.io.File
+
+class PinyinDictDiffTest {
+
+    private companion object {
+        @BeforeClass
+        @JvmStatic
+        fun setup() {
+            System.loadLibrary("native-lib")
+        }
+    }
+
+    private lateinit var dir: File
+
+    @Before
+    fun createDir() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        dir = File(context.cacheDir, "dict-diff-test").also { it.mkdirs() }
+    }
+
+    @After
+    fun deleteDir() {
+        dir.deleteRecursively()
+    }
+
+    private fun binaryDict(name: String, vararg lines: String): File {
+        val txt = File(dir, "$name.txt").apply { writeText(lines.joinToString("\n")) }
+        val bin = File(dir, "$name.dict")
+        PinyinDictManager.pinyinDictConv(
+            txt.absolutePath,
+            bin.absolutePath,
+            PinyinDictManager.MODE_TXT_TO_BIN,
+            null
+        )
+        return bin
+    }
+
+    private fun textLines(bin: File): List<String> {
+        val txt = File(dir, "${bin.nameWithoutExtension}.out.txt")
+        PinyinDictManager.pinyinDictConv(
+            bin.absolutePath,
+            txt.absolutePath,
+            PinyinDictManager.MODE_BIN_TO_TXT,
+            null
+        )
+        return txt.readLines().filter { it.isNotBlank() }.sorted()
+    }
+
+    @Test
+    fun testPatchOfDiffEqualsNew() {
+        val old = binaryDict("old", "你好 ni'hao 0", "世界 shi'jie -1", "拼音 pin'yin -2")
+        val new = binaryDict("new", "你好 ni'hao 0", "世界 shi'jie -0.5", "输入 shu'ru -3")
+        val diff = File(dir, "diff")
+        val changed = PinyinDictManager.pinyinDictDiff(old.absolutePath, new.absolutePath, diff.absolutePath)
+        // 拼音 removed, 世界 re-weighted, 输入 added
+        Assert.assertEquals(3, changed)
+        val patched = File(dir, "patched.dict")
+        PinyinDictManager.pinyinDictPatch(old.absolutePath, diff.absolutePath, patched.absolutePath)
+        Assert.assertEquals(textLines(new), textLines(patched))
+    }
+
+    @Test
+    fun testDiffIsDeterministic() {
+        val old = binaryDict("old", "你好 ni'hao 0", "世界 shi'jie -1")
+        val new = binaryDict("new", "世界 shi'jie -1", "输入 shu'ru -3", "你好 ni'hao 0")
+        val diff1 = File(dir, "diff1")
+        val diff2 = File(dir, "diff2")
+        PinyinDictManager.pinyinDictDiff(old.absolutePath, new.absolutePath, diff1.absolutePath)
+        PinyinDictManager.pinyinDictDiff(old.absolutePath, new.absolutePath, diff2.absolutePath)
+        Assert.assertArrayEquals(diff1.readBytes(), diff2.readBytes())
+    }
+
+    @Test
+    fun testPatchRejectsWrongBase() {
+        val old = binaryDict("old", "你好 ni'hao 0")
+        val new = binaryDict("new", "你好 ni'hao -1")
+        val other = binaryDict("other", "世界 shi'jie 0")
+        val diff = File(dir, "diff")
+        PinyinDictManager.pinyinDictDiff(old.absolutePath, new.absolutePath, diff.absolutePath)
+        val patched = File(dir, "patched.dict")
+        Assert.assertThrows(Exception::class.java) {
+            PinyinDictManager.pinyinDictPatch(other.absolutePath, diff.absolutePath, patched.absolutePath)
+        }
+    }
+
+}
@@ -0,0 +1,119 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+package org.fcitx.fcitx5.android
+
+import androidx.test.platform.app.InstrumentationRegistry
+import org.fcitx.fcitx5.android.data.pinyin.PinyinDictManager
+import org.junit.After
+import org.junit.Assert
+import org.junit.Before
+import org.junit.BeforeClass
+import org.junit.Test
+import java.io.File
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+class SougouDictConvBenchmark {
+
+    private companion object {
+        @BeforeClass
+        @JvmStatic
+        fun setup() {
+            System.loadLibrary("native-lib")
+        }
+
+        const val WordCount = 500_000
+
+        val Syllables = arrayOf(
+            "a", "ba", "ci", "de", "fa", "ge", "hu", "ji", "ka", "le",
+            "ma", "ni", "po", "qu", "ri", "si", "ta", "wu", "xi", "zhe"
+        )
+
+        /**
+         * Write [WordCount] distinct three-character words as a .scel file, in the layout scel-dict.h reads:
+         * magic, pinyin table at 0x1540, then one word group per word at 0x2628
+         */
+        fun writeSyntheticScel(file: File) {
+            val buffer = ByteBuffer.allocate(0x2628 + WordCount * 24).order(ByteOrder.LITTLE_ENDIAN)
+            buffer.put(byteArrayOf(0x40, 0x15, 0, 0, 0x44, 0x43, 0x53, 0x01, 0x01, 0, 0, 0))
+            buffer.position(0x1540)
+            buffer.putInt(Syllables.size)
+            Syllables.forEachIndexed { i, s ->
+                buffer.putShort(i.toShort())
+                buffer.putShort((s.length * 2).toShort())
+                s.forEach { buffer.putChar(it) }
+            }
+            buffer.position(0x2628)
+            for (i in 0 until WordCount) {
+                val chars = intArrayOf(i / 10000, i / 100 % 100, i % 100)
+                // one word in this group, with pinyin of 3 syllables
+                buffer.putShort(1)
+                buffer.putShort(6)
+                chars.forEach { buffer.putShort((it % Syllables.size).toShort()) }
+                buffer.putShort(6)
+                chars.forEach { buffer.putChar((0x4e00 + it).toChar()) }
+                // extra data: frequency and padding
+                buffer.putShort(4)
+                buffer.putInt(i)
+            }
+            file.writeBytes(buffer.array().copyOf(buffer.position()))
+        }
+    }
+
+    private lateinit var dir: File
+
+    @Before
+    fun createDir() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        dir = File(context.cacheDir, "scel-benchmark").also { it.mkdirs() }
+    }
+
+    @After
+    fun deleteDir() {
+        dir.deleteRecursively()
+    }
+
+    private fun textDump(bin: File): ByteArray {
+        val txt = File(dir, "${bin.nameWithoutExtension}.out.txt")
+        PinyinDictManager.pinyinDictConv(
+            bin.absolutePath,
+            txt.absolutePath,
+            PinyinDictManager.MODE_BIN_TO_TXT,
+            null
+        )
+        return txt.readBytes().also { txt.delete() }
+    }
+
+    /**
+     * The two-step pipeline wrote scel as text in a separate libscel2org5 process, then parsed the text again.
+     * That binary is gone, so the first step is decoded in process here too: the baseline leaves out the cost
+     * of spawning a process, and the RSS of that process, so it favours the two-step pipeline.
+     */
+    @Test
+    fun benchmarkScelToBinary() {
+        val src = File(dir, "synthetic.scel").also { writeSyntheticScel(it) }
+        val txt = File(dir, "two-step.txt")
+        val twoStep = File(dir, "two-step.dict")
+        val direct = File(dir, "direct.dict")
+        val twoStepResult = Benchmark.measure {
+            PinyinDictManager.sougouDictConv(src.absolutePath, txt.absolutePath, true, null)
+            PinyinDictManager.pinyinDictConv(
+                txt.absolutePath,
+                twoStep.absolutePath,
+                PinyinDictManager.MODE_TXT_TO_BIN,
+                null
+            )
+        }
+        val directResult = Benchmark.measure {
+            PinyinDictManager.sougouDictConv(src.absolutePath, direct.absolutePath, false, null)
+        }
+        Benchmark.report(
+            "sougouDictConv $WordCount words",
+            "scel to text to binary" to twoStepResult,
+            "scel to binary" to directResult
+        )
+        Assert.assertArrayEquals(textDump(twoStep), textDump(direct))
+    }
+}
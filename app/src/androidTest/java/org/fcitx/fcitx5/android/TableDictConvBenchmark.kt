@@ -0,0 +1,119 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+package org.fcitx.fcitx5.android
+
+import androidx.test.platform.app.InstrumentationRegistry
+import org.fcitx.fcitx5.android.data.table.TableManager
+import org.junit.After
+import org.junit.Assert
+import org.junit.Before
+import org.junit.BeforeClass
+import org.junit.Test
+import java.io.File
+
+class TableDictConvBenchmark {
+
+    companion object {
+        @BeforeClass
+        @JvmStatic
+        fun setup() {
+            System.loadLibrary("native-lib")
+            System.loadLibrary("native-test")
+        }
+
+        @JvmStatic
+        external fun loadAndSave(src: String, dest: String)
+
+        private const val EntryCount = 500_000
+
+        /**
+         * Write [EntryCount] entries in libime table text format,
+         * with distinct codes of 5 letters and distinct two-character words
+         */
+        fun writeSyntheticDict(file: File) {
+            file.bufferedWriter().use { out ->
+                out.write("KeyCode=abcdefghijklmnopqrstuvwxyz\nLength=5\n[Data]\n")
+                val code = CharArray(5)
+                for (i in 0 until EntryCount) {
+                    var n = i
+                    for (j in code.indices.reversed()) {
+                        code[j] = 'a' + n % 26
+                        n /= 26
+                    }
+                    out.write(code)
+                    out.write(" ")
+                    out.write(0x4e00 + i / 1000 % 1000)
+                    out.write(0x4e00 + i % 1000)
+                    out.write("\n")
+                }
+            }
+        }
+    }
+
+    private lateinit var dir: File
+
+    @Before
+    fun createDir() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        dir = File(context.cacheDir, "table-conv-benchmark").also { it.mkdirs() }
+    }
+
+    @After
+    fun deleteDir() {
+        dir.deleteRecursively()
+    }
+
+    private fun textDump(bin: File): ByteArray {
+        val txt = File(dir, "${bin.nameWithoutExtension}.out.txt")
+        TableManager.tableDictConv(
+            bin.absolutePath,
+            txt.absolutePath,
+            TableManager.MODE_BIN_TO_TXT,
+            null
+        )
+        return txt.readBytes().also { txt.delete() }
+    }
+
+    @Test
+    fun benchmarkTextToBinary() {
+        val src = File(dir, "synthetic.txt").also { writeSyntheticDict(it) }
+        val loaded = File(dir, "loaded.dict")
+        val streamed = File(dir, "streamed.dict")
+        val loadResult = Benchmark.measure { loadAndSave(src.absolutePath, loaded.absolutePath) }
+        var lastProcessed = -1L
+        val streamResult = Benchmark.measure {
+            TableManager.tableDictConv(
+                src.absolutePath,
+                streamed.absolutePath,
+                TableManager.MODE_TXT_TO_BIN
+            ) { processed, _ ->
+                lastProcessed = processed
+                true
+            }
+        }
+        Benchmark.report(
+            "tableDictConv $EntryCount entries",
+            "load and save" to loadResult,
+            "streaming" to streamResult
+        )
+        Assert.assertEquals(src.length(), lastProcessed)
+        Assert.assertArrayEquals(textDump(loaded), textDump(streamed))
+    }
+
+    @Test
+    fun testCancelKeepsNoOutput() {
+        val src = File(dir, "synthetic.txt").also { writeSyntheticDict(it) }
+        val dest = File(dir, "cancelled.dict")
+        val result = runCatching {
+            TableManager.tableDictConv(
+                src.absolutePath,
+                dest.absolutePath,
+                TableManager.MODE_TXT_TO_BIN
+            ) { processed, total -> processed < total / 2 }
+        }
+        Assert.assertTrue(result.isFailure)
+        Assert.assertFalse(dest.exists())
+    }
+}
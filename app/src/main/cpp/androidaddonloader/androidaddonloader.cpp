@@ -6,12 +6,97 @@
  */
 #include "androidaddonloader.h"
 
+#include <dirent.h>
+
+#include <chrono>
+#include <string_view>
+
 #define FCITX_LIBRARY_SUFFIX ".so"
 
 namespace fcitx {
 
+namespace {
+
+int64_t nowMicros() {
+    const auto t = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(t).count();
+}
+
+bool timedLoad(Library &lib, const std::string &name, Flags<LibraryLoadHint> flag,
+               AndroidLibraryLoadTiming &timing) {
+    const auto start = nowMicros();
+    const bool loaded = lib.load(flag);
+    timing = {name, lib.path(), start, nowMicros() - start, loaded};
+    return loaded;
+}
+
+}
+
 AndroidSharedLibraryLoader::AndroidSharedLibraryLoader(AndroidLibraryDependency dependency)
-        : dependency_(std::move(dependency)) {}
+        : libraryIndex_(buildIndex(standardPath_)),
+          dependency_(std::move(dependency)) {}
+
+bool AndroidSharedLibraryLoader::update(AndroidLibraryDependency dependency) {
+    for (const auto &[name, deps]: dependency_) {
+        auto iter = dependency.find(name);
+        if (iter == dependency.end() || iter->second != deps) {
+            return false;
+        }
+    }
+    // StandardPath reads FCITX_ADDON_DIRS on construction, which has been changed by caller
+    auto libraryIndex = buildIndex(StandardPath());
+    // a library that has been opened would keep its old file, or be shadowed by a new one
+    for (const auto &timing: loadTimings_) {
+        if (!timing.loaded) {
+            continue;
+        }
+        const auto file = timing.name + FCITX_LIBRARY_SUFFIX;
+        auto iter = libraryIndex.find(file);
+        if (iter == libraryIndex.end() || iter->second != locate(file)) {
+            return false;
+        }
+    }
+    dependency_ = std::move(dependency);
+    libraryIndex_ = std::move(libraryIndex);
+    return true;
+}
+
+AndroidLibraryIndex AndroidSharedLibraryLoader::buildIndex(const StandardPath &standardPath) {
+    AndroidLibraryIndex libraryIndex;
+    std::vector<std::string> dirs;
+    auto userDir = standardPath.userDirectory(StandardPath::Type::Addon);
+    if (!userDir.empty()) {
+        dirs.push_back(std::move(userDir));
+    }
+    for (const auto &dir: standardPath.directories(StandardPath::Type::Addon)) {
+        dirs.push_back(dir);
+    }
+    // one readdir per directory, instead of one stat per directory for every library
+    for (const auto &dir: dirs) {
+        DIR *d = opendir(dir.c_str());
+        if (!d) {
+            continue;
+        }
+        while (const auto *entry = readdir(d)) {
+            if (entry->d_type != DT_REG && entry->d_type != DT_LNK && entry->d_type != DT_UNKNOWN) {
+                continue;
+            }
+            std::string_view name(entry->d_name);
+            if (!stringutils::endsWith(name, FCITX_LIBRARY_SUFFIX)) {
+                continue;
+            }
+            libraryIndex[std::string(name)].push_back(dir + "/" + entry->d_name);
+        }
+        closedir(d);
+    }
+    return libraryIndex;
+}
+
+const std::vector<std::string> &AndroidSharedLibraryLoader::locate(const std::string &file) const {
+    static const std::vector<std::string> empty;
+    auto iter = libraryIndex_.find(file);
+    return iter == libraryIndex_.end() ? empty : iter->second;
+}
 
 AddonInstance *AndroidSharedLibraryLoader::load(const AddonInfo &info,
                                                 AddonManager *manager) {
@@ -24,7 +109,7 @@ AddonInstance *AndroidSharedLibraryLoader::load(const AddonInfo &info,
             flag |= LibraryLoadHint::ExportExternalSymbolsHint;
         }
         auto file = libname + FCITX_LIBRARY_SUFFIX;
-        auto libs = standardPath_.locateAll(StandardPath::Type::Addon, file);
+        const auto &libs = locate(file);
         if (libs.empty()) {
             FCITX_ERROR() << "Could not locate library " << file
                           << " for addon " << info.uniqueName() << ".";
@@ -34,14 +119,15 @@ AddonInstance *AndroidSharedLibraryLoader::load(const AddonInfo &info,
         if (deps != dependency_.end()) {
             for (const auto &dep: deps->second) {
                 auto depFile = dep + FCITX_LIBRARY_SUFFIX;
-                auto depPaths = standardPath_.locateAll(StandardPath::Type::Addon, depFile);
+                const auto &depPaths = locate(depFile);
                 if (depPaths.empty()) {
                     FCITX_ERROR() << "Could not locate dependency " << depFile
                                   << " for library " << file << ".";
                 } else {
                     for (const auto &depPath: depPaths) {
                         Library depLib(depPath);
-                        if (!depLib.load()) {
+                        if (!timedLoad(depLib, dep, LibraryLoadHint::DefaultHint,
+                                       loadTimings_.emplace_back())) {
                             FCITX_ERROR() << "Failed to load dependency " << depPath
                                           << " for library " << file << ".";
                         } else {
@@ -56,7 +142,7 @@ AddonInstance *AndroidSharedLibraryLoader::load(const AddonInfo &info,
         // ========== Android specific end ========== //
         for (const auto &libraryPath: libs) {
             Library lib(libraryPath);
-            if (!lib.load(flag)) {
+            if (!timedLoad(lib, libname, flag, loadTimings_.emplace_back())) {
                 FCITX_ERROR()
                     << "Failed to load library for addon " << info.uniqueName()
                     << " on " << libraryPath << ". Error: " << lib.error();
@@ -77,14 +163,23 @@ AddonInstance *AndroidSharedLibraryLoader::load(const AddonInfo &info,
         return nullptr;
     }
 
+    // addons may load other addons in create(), so record the start before calling it
+    const auto index = createTimings_.size();
+    createTimings_.push_back({info.uniqueName(), nowMicros(), 0});
+    auto finishTiming = [this, index]() {
+        createTimings_[index].durationMicros = nowMicros() - createTimings_[index].startMicros;
+    };
     try {
-        return iter->second->factory()->create(manager);
+        auto *addon = iter->second->factory()->create(manager);
+        finishTiming();
+        return addon;
     } catch (const std::exception &e) {
         FCITX_ERROR() << "Failed to create addon: " << info.uniqueName() << " "
                       << e.what();
     } catch (...) {
         FCITX_ERROR() << "Failed to create addon: " << info.uniqueName();
     }
+    finishTiming();
     return nullptr;
 }
 
@@ -7,7 +7,11 @@
 #ifndef FCITX5_ANDROID_ANDROIDADDONLOADER_H
 #define FCITX5_ANDROID_ANDROIDADDONLOADER_H
 
+#include <cstdint>
 #include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
 #include <fcitx-utils/library.h>
 #include <fcitx-utils/standardpath.h>
 #include <fcitx/addonloader.h>
@@ -41,6 +45,24 @@ private:
 
 typedef std::unordered_map<std::string, std::unordered_set<std::string>> AndroidLibraryDependency;
 
+// file name -> paths in addon directories
+typedef std::unordered_map<std::string, std::vector<std::string>> AndroidLibraryIndex;
+
+// time points are microseconds of steady_clock
+struct AndroidLibraryLoadTiming {
+    std::string name;
+    std::string path;
+    int64_t startMicros;
+    int64_t durationMicros;
+    bool loaded;
+};
+
+struct AndroidAddonCreateTiming {
+    std::string name;
+    int64_t startMicros;
+    int64_t durationMicros;
+};
+
 class AndroidSharedLibraryLoader : public AddonLoader {
 public:
     AndroidSharedLibraryLoader(AndroidLibraryDependency dependency);
@@ -49,10 +71,34 @@ public:
 
     AddonInstance *load(const AddonInfo &info, AddonManager *manager) override;
 
+    /**
+     * Replace dependency map and list addon directories again, after plugins have been installed.
+     * Nothing is changed unless it succeeds.
+     * @return false if a library already known has been removed or has different dependencies,
+     *         or a library that has been opened would now be found at different paths,
+     *         which cannot be applied without a new loader
+     */
+    bool update(AndroidLibraryDependency dependency);
+
+    const std::vector<AndroidLibraryLoadTiming> &loadTimings() const { return loadTimings_; }
+
+    const std::vector<AndroidAddonCreateTiming> &createTimings() const { return createTimings_; }
+
+    /**
+     * paths of `file` in addon directories, in the same order as StandardPath::locateAll
+     */
+    const std::vector<std::string> &locate(const std::string &file) const;
+
 private:
     StandardPath standardPath_;
+    // addon directories are listed at construction and in update()
+    AndroidLibraryIndex libraryIndex_;
     std::unordered_map<std::string, std::unique_ptr<AndroidSharedLibraryFactory>> registry_;
     AndroidLibraryDependency dependency_;
+    std::vector<AndroidLibraryLoadTiming> loadTimings_;
+    std::vector<AndroidAddonCreateTiming> createTimings_;
+
+    static AndroidLibraryIndex buildIndex(const StandardPath &standardPath);
 };
 
 }
@@ -34,10 +34,13 @@ public:
     [[nodiscard]] const char *frontend() const override { return "androidfrontend"; }
 
     void commitStringImpl(const std::string &text) override {
+        // editor content changes, surrounding text would be sent again when cursor moves
+        surroundingText().invalidate();
         frontend_->commitString(text, -1);
     }
 
     void commitStringWithCursorImpl(const std::string &text, size_t cursor) override {
+        surroundingText().invalidate();
         frontend_->commitString(text, static_cast<int>(cursor));
     }
 
@@ -298,6 +301,16 @@ void AndroidFrontend::deactivateInputContext(const int uid) {
     activeIC_ = nullptr;
 }
 
+void AndroidFrontend::setSurroundingText(const std::string &text, const int cursor, const int anchor) {
+    if (!activeIC_) return;
+    if (cursor < 0 || anchor < 0) {
+        activeIC_->surroundingText().invalidate();
+    } else {
+        activeIC_->surroundingText().setText(text, cursor, anchor);
+    }
+    activeIC_->updateSurroundingText();
+}
+
 void AndroidFrontend::setCapabilityFlags(uint64_t flag) {
     if (!activeIC_) return;
     activeIC_->setCapabilityFlags(CapabilityFlags(flag));
@@ -85,4 +85,7 @@ FCITX_ADDON_DECLARE_FUNCTION(AndroidFrontend, setToastCallback,
 FCITX_ADDON_DECLARE_FUNCTION(AndroidFrontend, forgetCandidate,
                              bool(int idx))
 
+FCITX_ADDON_DECLARE_FUNCTION(AndroidFrontend, setSurroundingText,
+                             void(const std::string &, const int, const int))
+
 #endif // _FCITX5_ANDROID_ANDROIDFRONTEND_PUBLIC_H_
@@ -2,7 +2,7 @@
  * SPDX-License-Identifier: LGPL-2.1-or-later
  * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
  */
-#include <fcitx-utils/utf8.h>
+#include <fcitx-utils/cutf8.h>
 #include <fcitx-utils/charutils.h>
 #include <fcitx/instance.h>
 #include <fcitx/candidatelist.h>
@@ -20,11 +20,20 @@ namespace {
 
 class AndroidKeyboardCandidateWord : public CandidateWord {
 public:
-    AndroidKeyboardCandidateWord(AndroidKeyboardEngine *engine, Text text, std::string commit)
+    AndroidKeyboardCandidateWord(AndroidKeyboardEngine *engine, Text text, std::string commit,
+                                 size_t deleteBefore = 0, size_t deleteAfter = 0)
             : CandidateWord(std::move(text)), engine_(engine),
-              commit_(std::move(commit)) {}
+              commit_(std::move(commit)),
+              deleteBefore_(deleteBefore), deleteAfter_(deleteAfter) {}
 
     void select(InputContext *inputContext) const override {
+        if (deleteBefore_ || deleteAfter_) {
+            // clear preedit first, then replace the part of word that is already in editor
+            inputContext->inputPanel().reset();
+            inputContext->updatePreedit();
+            inputContext->deleteSurroundingText(-static_cast<int>(deleteBefore_),
+                                                static_cast<unsigned int>(deleteBefore_ + deleteAfter_));
+        }
         inputContext->commitString(commit_);
         inputContext->inputPanel().reset();
         inputContext->updatePreedit();
@@ -37,6 +46,8 @@ public:
 private:
     AndroidKeyboardEngine *engine_;
     std::string commit_;
+    size_t deleteBefore_;
+    size_t deleteAfter_;
 };
 
 } // namespace
@@ -56,6 +67,17 @@ AndroidKeyboardEngine::AndroidKeyboardEngine(Instance *instance)
         wordHintAction_.update(ic);
     });
     instance_->userInterfaceManager().registerAction("androidkeyboard-word-hint", &wordHintAction_);
+    eventHandlers_.emplace_back(instance_->watchEvent(
+            EventType::InputContextSurroundingTextUpdated,
+            EventWatcherPhase::Default,
+            [this](Event &event) {
+                auto *inputContext = static_cast<InputContextEvent &>(event).inputContext();
+                if (instance_->inputMethodEngine(inputContext) != this) {
+                    return;
+                }
+                updateSurroundingWord(inputContext);
+            }
+    ));
 }
 
 static inline bool isValidSym(const Key &key) {
@@ -108,8 +130,11 @@ void AndroidKeyboardEngine::keyEvent(const InputMethodEntry &entry, KeyEvent &ev
         }
         if (key.isLAZ() || key.isUAZ() || validSym ||
             (!buffer.empty() && key.checkKeyList(FCITX_HYPHEN_APOS))) {
-            auto text = Key::keySymToUTF8(key.sym());
-            if (updateBuffer(inputContext, text)) {
+            // encode on stack, avoid allocating a std::string for every key stroke
+            char text[FCITX_UTF8_MAX_LENGTH + 1];
+            const auto code = Key::keySymToUnicode(key.sym());
+            const auto length = code ? fcitx_ucs4_to_utf8(code, text) : 0;
+            if (updateBuffer(inputContext, std::string_view(text, length))) {
                 return event.filterAndAccept();
             }
         }
@@ -157,6 +182,12 @@ void AndroidKeyboardEngine::keyEvent(const InputMethodEntry &entry, KeyEvent &ev
 
     // if we reach here, just commit and discard buffer.
     commitBuffer(inputContext);
+    // hints for the word around cursor are no longer relevant
+    if (state->words_.inWord()) {
+        state->words_.reset();
+        inputContext->inputPanel().reset();
+        inputContext->updateUserInterface(UserInterfaceComponent::InputPanel);
+    }
     if (state->prependSpace_) {
         state->prependSpace_ = false;
     }
@@ -241,24 +272,72 @@ void AndroidKeyboardEngine::resetState(InputContext *inputContext, bool fromCand
     auto *state = inputContext->propertyFor(&factory_);
     state->reset();
     if (fromCandidate) {
-        // TODO set prependSpace_ to false when cursor moves; maybe it's time to implement SurroundingText
+        // would be cleared in updateSurroundingWord when cursor moves
         state->prependSpace_ = *config_.insertSpace;
     }
 }
 
+void AndroidKeyboardEngine::updateSurroundingWord(InputContext *inputContext) {
+    auto *state = inputContext->propertyFor(&factory_);
+    // surrounding text does not include preedit, the buffer is the source of truth when composing
+    if (!state->buffer_.empty()) {
+        return;
+    }
+    const auto &surrounding = inputContext->surroundingText();
+    if (!surrounding.isValid() || surrounding.cursor() != surrounding.anchor()) {
+        state->words_.reset();
+        state->prependSpace_ = false;
+        return;
+    }
+    const bool wasInWord = state->words_.inWord();
+    if (!state->words_.update(surrounding.text(), surrounding.cursor())) {
+        return;
+    }
+    // cursor has moved away from the word we just committed
+    state->prependSpace_ = false;
+    auto *entry = instance_->inputMethodEntry(inputContext);
+    if (!entry || !hintEnabled(inputContext, *entry)) {
+        return;
+    }
+    if (state->words_.inWord()) {
+        updateCandidate(*entry, inputContext);
+    } else if (wasInWord) {
+        inputContext->inputPanel().reset();
+        inputContext->updateUserInterface(UserInterfaceComponent::InputPanel);
+    }
+}
+
 void AndroidKeyboardEngine::updateCandidate(const InputMethodEntry &entry, InputContext *inputContext) {
     inputContext->inputPanel().reset();
     auto *state = inputContext->propertyFor(&factory_);
+    const auto &words = state->words_;
+    // the part of word already in editor before cursor is a prefix of buffer;
+    // when not composing, complete the whole word around cursor
+    auto &word = state->scratch_;
+    word.clear();
+    size_t deleteBefore = 0;
+    size_t deleteAfter = 0;
+    if (!state->prependSpace_) {
+        word.append(words.before());
+        deleteBefore = words.beforeLength();
+    }
+    word.append(state->buffer_.userInput());
+    if (state->buffer_.empty()) {
+        word.append(words.after());
+        deleteAfter = words.afterLength();
+    }
     std::vector<std::pair<std::string, std::string>> results;
-    if (spell()) {
+    if (spell() && !word.empty()) {
         results = spell()->call<ISpell::hintForDisplay>(entry.languageCode(),
                                                         SpellProvider::Default,
-                                                        state->buffer_.userInput(),
+                                                        word,
                                                         SpellCandidateSize);
     }
     auto candidateList = std::make_unique<CommonCandidateList>();
-    for (const auto &result: results) {
-        candidateList->append<AndroidKeyboardCandidateWord>(this, Text(result.first), result.second);
+    for (auto &result: results) {
+        candidateList->append<AndroidKeyboardCandidateWord>(this, Text(std::move(result.first)),
+                                                            std::move(result.second),
+                                                            deleteBefore, deleteAfter);
     }
     candidateList->setPageSize(*config_.pageSize);
     candidateList->setSelectionKey(selectionKeys_);
@@ -271,42 +350,35 @@ void AndroidKeyboardEngine::updateCandidate(const InputMethodEntry &entry, Input
 void AndroidKeyboardEngine::updateUI(InputContext *inputContext) {
     auto [text, cursor] = preeditWithCursor(inputContext);
     if (inputContext->capabilityFlags().test(CapabilityFlag::Preedit)) {
-        Text clientPreedit(text, TextFormatFlag::Underline);
+        // Text owns its strings, this is the only copy of preedit
+        Text clientPreedit(std::string(text), TextFormatFlag::Underline);
         clientPreedit.setCursor(static_cast<int>(cursor));
         inputContext->inputPanel().setClientPreedit(clientPreedit);
         inputContext->updatePreedit();
     } else {
-        Text preedit(text);
+        Text preedit{std::string(text)};
         preedit.setCursor(static_cast<int>(cursor));
         inputContext->inputPanel().setPreedit(preedit);
     }
     inputContext->updateUserInterface(UserInterfaceComponent::InputPanel);
 }
 
-bool AndroidKeyboardEngine::updateBuffer(InputContext *inputContext, const std::string &chr) {
+bool AndroidKeyboardEngine::updateBuffer(InputContext *inputContext, std::string_view chr) {
     auto *entry = instance_->inputMethodEntry(inputContext);
     if (!entry) {
         return false;
     }
 
     auto *state = inputContext->propertyFor(&factory_);
-    // word hint is disabled, input is password, or language not supported
-    if (!*config_.enableWordHint ||
-        (*config_.editorControlledWordHint && inputContext->capabilityFlags().test(CapabilityFlag::NoSpellCheck)) ||
-        inputContext->capabilityFlags().test(CapabilityFlag::Password) ||
-        !supportHint(entry->languageCode())) {
+    if (!hintEnabled(inputContext, *entry)) {
         return false;
     }
 
     auto &buffer = state->buffer_;
-    auto [preedit, cursor] = preeditWithCursor(inputContext);
-    if (preedit != buffer.userInput()) {
-        buffer.clear();
-        buffer.type(preedit);
+    if (!buffer.type(chr)) {
+        return false;
     }
 
-    buffer.type(chr);
-
     if (buffer.size() >= MaxBufferSize) {
         commitBuffer(inputContext);
         return true;
@@ -317,15 +389,18 @@ bool AndroidKeyboardEngine::updateBuffer(InputContext *inputContext, const std::
 }
 
 void AndroidKeyboardEngine::commitBuffer(InputContext *inputContext) {
-    auto [preedit, cursor] = preeditWithCursor(inputContext);
+    auto *state = inputContext->propertyFor(&factory_);
+    const auto preedit = state->buffer_.userInput();
     if (preedit.empty()) {
         return;
     }
-    auto characterCount = utf8::length(preedit, 0, cursor);
+    // commitString takes std::string, reuse the state's buffer instead of creating one every time
+    auto &text = state->scratch_;
+    text.assign(preedit);
     if (inputContext->capabilityFlags().test(CapabilityFlag::CommitStringWithCursor)) {
-        inputContext->commitStringWithCursor(preedit, characterCount);
+        inputContext->commitStringWithCursor(text, state->buffer_.cursor());
     } else {
-        inputContext->commitString(preedit);
+        inputContext->commitString(text);
     }
     resetState(inputContext);
     inputContext->inputPanel().reset();
@@ -333,12 +408,20 @@ void AndroidKeyboardEngine::commitBuffer(InputContext *inputContext) {
     inputContext->updateUserInterface(UserInterfaceComponent::InputPanel);
 }
 
+bool AndroidKeyboardEngine::hintEnabled(InputContext *inputContext, const InputMethodEntry &entry) {
+    // word hint is disabled, input is password, or language not supported
+    return *config_.enableWordHint &&
+           !(*config_.editorControlledWordHint && inputContext->capabilityFlags().test(CapabilityFlag::NoSpellCheck)) &&
+           !inputContext->capabilityFlags().test(CapabilityFlag::Password) &&
+           supportHint(entry.languageCode());
+}
+
 bool AndroidKeyboardEngine::supportHint(const std::string &language) {
     const bool hasSpell = spell() && spell()->call<ISpell::checkDict>(language);
     return hasSpell;
 }
 
-std::pair<std::string, size_t> AndroidKeyboardEngine::preeditWithCursor(InputContext *inputContext) {
+std::pair<std::string_view, size_t> AndroidKeyboardEngine::preeditWithCursor(InputContext *inputContext) {
     auto *state = inputContext->propertyFor(&factory_);
     return {state->buffer_.userInput(), state->buffer_.cursorByChar()};
 }
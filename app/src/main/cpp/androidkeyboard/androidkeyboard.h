@@ -5,13 +5,19 @@
 #ifndef _FCITX5_ANDROID_ANDROIDKEYBOARD_H_
 #define _FCITX5_ANDROID_ANDROIDKEYBOARD_H_
 
+#include <string_view>
+
 #include <fcitx-config/iniparser.h>
-#include <fcitx-utils/inputbuffer.h>
+#include <fcitx-utils/handlertable.h>
 #include <fcitx-utils/i18n.h>
 #include <fcitx/addonfactory.h>
 #include <fcitx/addonmanager.h>
 #include <fcitx/inputmethodengine.h>
 #include <fcitx/action.h>
+#include <fcitx/event.h>
+
+#include "fixedinputbuffer.h"
+#include "surroundingword.h"
 
 namespace fcitx {
 
@@ -42,21 +48,28 @@ FCITX_CONFIGURATION(
 
 class AndroidKeyboardEngine;
 
+static constexpr std::size_t AndroidKeyboardMaxBufferSize = 20;
+
 struct AndroidKeyboardEngineState : public InputContextProperty {
-    InputBuffer buffer_;
+    FixedInputBuffer<AndroidKeyboardMaxBufferSize> buffer_;
     std::string origKeyString_;
     bool prependSpace_ = false;
+    // word around cursor, rebuilt from SurroundingText when buffer is empty
+    SurroundingWordTracker words_;
+    // reused for the word passed to spell and the text to commit, keeps its capacity across keys
+    std::string scratch_;
 
     void reset() {
         buffer_.clear();
         origKeyString_.clear();
         prependSpace_ = false;
+        words_.reset();
     }
 };
 
 class AndroidKeyboardEngine final : public InputMethodEngineV3 {
 public:
-    static int constexpr MaxBufferSize = 20;
+    static int constexpr MaxBufferSize = AndroidKeyboardMaxBufferSize;
     static int constexpr SpellCandidateSize = 20;
 
     AndroidKeyboardEngine(Instance *instance);
@@ -91,6 +104,8 @@ public:
 //    FCITX_ADDON_DEPENDENCY_LOADER(quickphrase, instance_->addonManager());
 
     void updateCandidate(const InputMethodEntry &entry, InputContext *inputContext);
+    // Rebuild the word around cursor after it moves, and show hints for it.
+    void updateSurroundingWord(InputContext *inputContext);
     // Update preedit and send ui update.
     void updateUI(InputContext *inputContext);
 
@@ -99,7 +114,7 @@ public:
     // Return true if chr is pushed to buffer.
     // Return false if chr will be skipped by buffer, usually this means caller
     // need to call commit buffer and forward chr manually.
-    bool updateBuffer(InputContext *inputContext, const std::string &chr);
+    bool updateBuffer(InputContext *inputContext, std::string_view chr);
 
     // Commit current buffer, also reset the state.
     // See also preeditString().
@@ -109,15 +124,17 @@ public:
 
 private:
     bool supportHint(const std::string &language);
+    bool hintEnabled(InputContext *inputContext, const InputMethodEntry &entry);
     /**
      * preedit string and byte cursor
      */
-    std::pair<std::string, size_t> preeditWithCursor(InputContext *inputContext);
+    std::pair<std::string_view, size_t> preeditWithCursor(InputContext *inputContext);
 
     Instance *instance_;
     AndroidKeyboardEngineConfig config_;
     KeyList selectionKeys_;
     fcitx::SimpleAction wordHintAction_;
+    std::vector<std::unique_ptr<HandlerTableEntry<EventHandler>>> eventHandlers_;
 
     FactoryFor<AndroidKeyboardEngineState> factory_{
             [](InputContext &) { return new AndroidKeyboardEngineState; }
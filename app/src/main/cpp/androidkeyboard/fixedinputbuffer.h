@@ -0,0 +1,171 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef _FCITX5_ANDROID_FIXEDINPUTBUFFER_H_
+#define _FCITX5_ANDROID_FIXEDINPUTBUFFER_H_
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace fcitx {
+
+/**
+ * A UTF-8 input buffer with inline storage for at most MaxChars characters.
+ *
+ * It mimics the subset of fcitx::InputBuffer that AndroidKeyboardEngine uses,
+ * but never touches the heap: text lives in a fixed byte array, and the byte
+ * offset of every character is kept alongside, so cursor conversions are O(1).
+ */
+template<std::size_t MaxChars>
+class FixedInputBuffer {
+public:
+    // UTF-8 takes at most 4 bytes to encode a unicode character
+    static constexpr std::size_t MaxBytes = MaxChars * 4;
+    static_assert(MaxBytes <= UINT8_MAX, "byte offsets are stored as uint8_t");
+
+    /**
+     * insert s at cursor, and move cursor after it.
+     * @return false if s is not valid UTF-8 or the buffer would overflow, buffer is not changed
+     */
+    bool type(std::string_view s) {
+        std::size_t chars = 0;
+        for (std::size_t i = 0; i < s.size();) {
+            const auto len = charLength(s, i);
+            if (len == 0) {
+                return false;
+            }
+            i += len;
+            chars++;
+        }
+        if (chars == 0) {
+            return true;
+        }
+        if (size_ + chars > MaxChars || bytes_ + s.size() > MaxBytes) {
+            return false;
+        }
+        const auto at = offsets_[cursor_];
+        std::memmove(&data_[at + s.size()], &data_[at], bytes_ - at);
+        std::memcpy(&data_[at], s.data(), s.size());
+        bytes_ += s.size();
+        size_ += chars;
+        cursor_ += chars;
+        rebuildOffsets(cursor_ - chars);
+        return true;
+    }
+
+    /**
+     * remove the character before cursor
+     * @return false if cursor is at beginning
+     */
+    bool backspace() {
+        if (cursor_ == 0) {
+            return false;
+        }
+        erase(cursor_ - 1);
+        cursor_--;
+        return true;
+    }
+
+    /**
+     * remove the character after cursor
+     * @return false if cursor is at end
+     */
+    bool del() {
+        if (cursor_ == size_) {
+            return false;
+        }
+        erase(cursor_);
+        return true;
+    }
+
+    void clear() {
+        bytes_ = 0;
+        size_ = 0;
+        cursor_ = 0;
+    }
+
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+
+    /**
+     * @return length in characters
+     */
+    [[nodiscard]] std::size_t size() const { return size_; }
+
+    /**
+     * @return cursor position in characters
+     */
+    [[nodiscard]] std::size_t cursor() const { return cursor_; }
+
+    void setCursor(std::size_t cursor) {
+        cursor_ = cursor > size_ ? size_ : cursor;
+    }
+
+    /**
+     * @return cursor position in bytes, same as fcitx::InputBuffer::cursorByChar
+     */
+    [[nodiscard]] std::size_t cursorByChar() const { return offsets_[cursor_]; }
+
+    [[nodiscard]] std::string_view userInput() const { return {data_.data(), bytes_}; }
+
+private:
+    std::array<char, MaxBytes> data_{};
+    // offsets_[i] is the byte offset of i-th character; offsets_[size_] == bytes_
+    std::array<uint8_t, MaxChars + 1> offsets_{};
+    std::size_t bytes_ = 0;
+    std::size_t size_ = 0;
+    std::size_t cursor_ = 0;
+
+    /**
+     * @return byte length of the UTF-8 sequence starting at s[i], or 0 if it's malformed
+     */
+    static std::size_t charLength(std::string_view s, std::size_t i) {
+        const auto lead = static_cast<uint8_t>(s[i]);
+        std::size_t len;
+        if (lead < 0x80) {
+            return 1;
+        } else if ((lead & 0xe0) == 0xc0) {
+            len = 2;
+        } else if ((lead & 0xf0) == 0xe0) {
+            len = 3;
+        } else if ((lead & 0xf8) == 0xf0) {
+            len = 4;
+        } else {
+            return 0;
+        }
+        if (i + len > s.size()) {
+            return 0;
+        }
+        for (std::size_t j = 1; j < len; j++) {
+            if ((static_cast<uint8_t>(s[i + j]) & 0xc0) != 0x80) {
+                return 0;
+            }
+        }
+        return len;
+    }
+
+    void erase(std::size_t index) {
+        const auto begin = offsets_[index];
+        const auto end = offsets_[index + 1];
+        std::memmove(&data_[begin], &data_[end], bytes_ - end);
+        bytes_ -= end - begin;
+        size_--;
+        rebuildOffsets(index);
+    }
+
+    void rebuildOffsets(std::size_t from) {
+        std::size_t offset = offsets_[from];
+        const std::string_view view = userInput();
+        for (std::size_t i = from; i < size_; i++) {
+            offsets_[i] = static_cast<uint8_t>(offset);
+            offset += charLength(view, offset);
+        }
+        offsets_[size_] = static_cast<uint8_t>(bytes_);
+    }
+};
+
+} // namespace fcitx
+
+#endif //_FCITX5_ANDROID_FIXEDINPUTBUFFER_H_
@@ -0,0 +1,171 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef _FCITX5_ANDROID_SURROUNDINGWORD_H_
+#define _FCITX5_ANDROID_SURROUNDINGWORD_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <fcitx-utils/cutf8.h>
+
+namespace fcitx {
+
+/**
+ * Extracts the word around cursor, and the word before it, from SurroundingText.
+ *
+ * The last text and cursor are cached: when only the cursor moves, the byte offset of cursor is
+ * found by stepping from the previous one, and only the characters around cursor are scanned.
+ */
+class SurroundingWordTracker {
+public:
+    /**
+     * @param text surrounding text
+     * @param cursor cursor position in characters
+     * @return whether the word around cursor (or the word before it) has changed
+     */
+    bool update(const std::string &text, unsigned int cursor) {
+        size_t cursorByte;
+        if (valid_ && text == text_) {
+            cursorByte = stepFrom(cursorByte_, cursorChar_, cursor);
+        } else {
+            // assign() reuses the existing capacity
+            text_.assign(text);
+            cursorByte = stepFrom(0, 0, cursor);
+        }
+        valid_ = true;
+        cursorChar_ = cursor;
+        cursorByte_ = cursorByte;
+
+        const std::string_view view(text_);
+        const size_t wordBegin = scanBackward(view, cursorByte);
+        const size_t wordEnd = scanForward(view, cursorByte);
+        size_t prevEnd = wordBegin;
+        // skip separators between previous word and current word
+        while (prevEnd > 0) {
+            const size_t p = prevChar(view, prevEnd);
+            if (isWordChar(charAt(view, p))) break;
+            prevEnd = p;
+        }
+        const size_t prevBegin = scanBackward(view, prevEnd);
+
+        const auto before = view.substr(wordBegin, cursorByte - wordBegin);
+        const auto after = view.substr(cursorByte, wordEnd - cursorByte);
+        const auto previous = view.substr(prevBegin, prevEnd - prevBegin);
+        if (before == before_ && after == after_ && previous == previous_) {
+            return false;
+        }
+        before_.assign(before);
+        after_.assign(after);
+        previous_.assign(previous);
+        beforeLength_ = fcitx_utf8_strnlen(before.data(), before.size());
+        afterLength_ = fcitx_utf8_strnlen(after.data(), after.size());
+        return true;
+    }
+
+    void reset() {
+        valid_ = false;
+        before_.clear();
+        after_.clear();
+        previous_.clear();
+        beforeLength_ = 0;
+        afterLength_ = 0;
+    }
+
+    /**
+     * part of current word before cursor
+     */
+    [[nodiscard]] const std::string &before() const { return before_; }
+
+    /**
+     * part of current word after cursor
+     */
+    [[nodiscard]] const std::string &after() const { return after_; }
+
+    /**
+     * the word preceding current word
+     */
+    [[nodiscard]] const std::string &previous() const { return previous_; }
+
+    [[nodiscard]] size_t beforeLength() const { return beforeLength_; }
+
+    [[nodiscard]] size_t afterLength() const { return afterLength_; }
+
+    [[nodiscard]] bool inWord() const { return !before_.empty() || !after_.empty(); }
+
+    static bool isWordChar(uint32_t c) {
+        if (c < 0x80) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                   c == '\'' || c == '-';
+        }
+        // Latin-1 Supplement and Latin Extended-A/B letters, excluding × and ÷
+        return c >= 0xc0 && c <= 0x24f && c != 0xd7 && c != 0xf7;
+    }
+
+private:
+    bool valid_ = false;
+    std::string text_;
+    unsigned int cursorChar_ = 0;
+    size_t cursorByte_ = 0;
+    std::string before_;
+    std::string after_;
+    std::string previous_;
+    size_t beforeLength_ = 0;
+    size_t afterLength_ = 0;
+
+    static uint32_t charAt(std::string_view s, size_t i) {
+        uint32_t c = 0;
+        fcitx_utf8_get_char(s.data() + i, &c);
+        return c;
+    }
+
+    static size_t prevChar(std::string_view s, size_t i) {
+        do {
+            i--;
+        } while (i > 0 && (static_cast<uint8_t>(s[i]) & 0xc0) == 0x80);
+        return i;
+    }
+
+    static size_t nextChar(std::string_view s, size_t i) {
+        do {
+            i++;
+        } while (i < s.size() && (static_cast<uint8_t>(s[i]) & 0xc0) == 0x80);
+        return i;
+    }
+
+    /**
+     * move from byte offset `byte` (which is character `from`) to character `to`
+     */
+    size_t stepFrom(size_t byte, unsigned int from, unsigned int to) const {
+        const std::string_view view(text_);
+        for (; from < to && byte < view.size(); from++) {
+            byte = nextChar(view, byte);
+        }
+        for (; from > to && byte > 0; from--) {
+            byte = prevChar(view, byte);
+        }
+        return byte;
+    }
+
+    static size_t scanBackward(std::string_view s, size_t i) {
+        while (i > 0) {
+            const size_t p = prevChar(s, i);
+            if (!isWordChar(charAt(s, p))) break;
+            i = p;
+        }
+        return i;
+    }
+
+    static size_t scanForward(std::string_view s, size_t i) {
+        while (i < s.size() && isWordChar(charAt(s, i))) {
+            i = nextChar(s, i);
+        }
+        return i;
+    }
+};
+
+} // namespace fcitx
+
+#endif //_FCITX5_ANDROID_SURROUNDINGWORD_H_
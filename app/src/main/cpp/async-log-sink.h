@@ -0,0 +1,218 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef FCITX5_ANDROID_ASYNC_LOG_SINK_H
+#define FCITX5_ANDROID_ASYNC_LOG_SINK_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#else
+#include <cstdio>
+
+// stand-in for host builds, so that logging can be tested on Linux
+typedef enum android_LogPriority {
+    ANDROID_LOG_UNKNOWN = 0,
+    ANDROID_LOG_DEFAULT,
+    ANDROID_LOG_VERBOSE,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR,
+    ANDROID_LOG_FATAL,
+    ANDROID_LOG_SILENT,
+} android_LogPriority;
+
+inline int __android_log_write(int prio, const char *tag, const char *text) {
+    static constexpr char Levels[] = "??VDIWEFS";
+    return std::fprintf(stderr, "%c/%s: %s\n", Levels[prio < 0 || prio > 8 ? 0 : prio], tag, text);
+}
+#endif
+
+/**
+ * Moves __android_log_write off the logging threads. Lines are copied into a bounded lock-free
+ * multi-producer ring (Vyukov's bounded queue), and a background thread writes them in batches,
+ * joining consecutive lines of the same priority into one write.
+ *
+ * When the ring is full, lines are dropped and counted, the count is reported once there is room.
+ * Fatal lines are written synchronously, since the process is about to abort, after the lines
+ * already in the ring, which may explain the abort.
+ */
+class AsyncLogSink {
+public:
+    // __android_log_write, or a stand-in in tests
+    typedef int (*Writer)(int prio, const char *tag, const char *text);
+
+    // same as the buffer of native_streambuf, longer lines arrive in pieces anyway
+    static constexpr size_t MaxLineLength = 128;
+    static constexpr size_t Capacity = 512;
+    // logd truncates longer messages
+    static constexpr size_t MaxBatchLength = 4000;
+
+    explicit AsyncLogSink(const char *tag, Writer writer = &__android_log_write)
+            : tag_(tag), writer_(writer) {
+        for (size_t i = 0; i < Capacity; i++) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        thread_ = std::thread([this]() { drainLoop(); });
+    }
+
+    AsyncLogSink(const AsyncLogSink &) = delete;
+
+    ~AsyncLogSink() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopped_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+    /**
+     * @return false if the line has been dropped because the ring is full
+     */
+    bool write(android_LogPriority prio, const char *text) {
+        if (prio >= ANDROID_LOG_FATAL) {
+            std::lock_guard<std::mutex> lock(drainMutex_);
+            std::string batch;
+            drain(batch);
+            writer_(prio, tag_, text);
+            return true;
+        }
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        Slot *slot;
+        for (;;) {
+            slot = &slots_[pos % Capacity];
+            const size_t seq = slot->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        slot->prio = prio;
+        size_t length = strnlen(text, MaxLineLength);
+        // lines are joined with '\n' when written
+        while (length > 0 && text[length - 1] == '\n') {
+            length--;
+        }
+        slot->length = static_cast<uint16_t>(length);
+        std::memcpy(slot->text, text, slot->length);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        // pairs with the fence in drainLoop(), either this sees `sleeping_`, or drain thread sees the line
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // only take the lock when drain thread is (about to be) waiting
+        if (sleeping_.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cv_.notify_one();
+        }
+        return true;
+    }
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        android_LogPriority prio;
+        uint16_t length;
+        char text[MaxLineLength];
+    };
+
+    const char *tag_;
+    Writer writer_;
+    std::array<Slot, Capacity> slots_;
+    alignas(64) std::atomic<size_t> enqueuePos_{0};
+    // held while draining, by drain thread, or by the thread writing a fatal line;
+    // never taken together with mutex_
+    std::mutex drainMutex_;
+    // written under drainMutex_, also read by the wait predicate of drain thread
+    std::atomic<size_t> dequeuePos_{0};
+    std::atomic<uint64_t> dropped_{0};
+    // guarded by drainMutex_
+    uint64_t droppedReported_ = 0;
+    std::atomic<bool> sleeping_{false};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopped_ = false;
+    std::thread thread_;
+
+    bool readable(size_t pos) const {
+        return slots_[pos % Capacity].sequence.load(std::memory_order_acquire) == pos + 1;
+    }
+
+    bool readable() const {
+        return readable(dequeuePos_.load(std::memory_order_relaxed));
+    }
+
+    void drainLoop() {
+        std::string batch;
+        batch.reserve(MaxBatchLength + 1);
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> drainLock(drainMutex_);
+                drain(batch);
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (stopped_) {
+                lock.unlock();
+                std::lock_guard<std::mutex> drainLock(drainMutex_);
+                drain(batch);
+                return;
+            }
+            sleeping_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            cv_.wait_for(lock, std::chrono::milliseconds(500), [this]() { return stopped_ || readable(); });
+            sleeping_.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    void drain(std::string &batch) {
+        android_LogPriority batchPrio = ANDROID_LOG_UNKNOWN;
+        auto flush = [&]() {
+            if (!batch.empty()) {
+                writer_(batchPrio, tag_, batch.c_str());
+                batch.clear();
+            }
+        };
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        while (readable(pos)) {
+            auto &slot = slots_[pos % Capacity];
+            if (slot.prio != batchPrio || batch.size() + 1 + slot.length > MaxBatchLength) {
+                flush();
+                batchPrio = slot.prio;
+            }
+            if (!batch.empty()) {
+                batch.push_back('\n');
+            }
+            batch.append(slot.text, slot.length);
+            slot.sequence.store(pos + Capacity, std::memory_order_release);
+            dequeuePos_.store(++pos, std::memory_order_relaxed);
+        }
+        flush();
+        const auto dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped != droppedReported_) {
+            const auto message = "Dropped " + std::to_string(dropped - droppedReported_) + " log lines";
+            writer_(ANDROID_LOG_WARN, tag_, message.c_str());
+            droppedReported_ = dropped;
+        }
+    }
+};
+
+#endif //FCITX5_ANDROID_ASYNC_LOG_SINK_H
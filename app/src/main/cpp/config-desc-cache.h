@@ -0,0 +1,79 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef FCITX5_ANDROID_CONFIG_DESC_CACHE_H
+#define FCITX5_ANDROID_CONFIG_DESC_CACHE_H
+
+#include <map>
+#include <string>
+#include <tuple>
+
+#include <fcitx-config/configuration.h>
+#include <fcitx-config/rawconfig.h>
+
+#include "flat-config.h"
+
+/**
+ * Flattened descriptions of configurations, which only change with the build of addon and locale.
+ *
+ * Entries are keyed by addon, config path, locale and addon version, and should be cleared when addons are
+ * reloaded, in case they describe their config differently after that.
+ */
+class ConfigDescCache {
+public:
+    struct Key {
+        std::string addon;
+        std::string path;
+        std::string locale;
+        std::string version;
+
+        bool operator<(const Key &other) const {
+            return std::tie(addon, path, locale, version) <
+                   std::tie(other.addon, other.path, other.locale, other.version);
+        }
+    };
+
+    /**
+     * @return "desc" node with description of `conf`, dumped if not cached yet
+     */
+    const FlatConfig &get(const Key &key, const fcitx::Configuration &conf) {
+        auto iter = cache_.find(key);
+        if (iter == cache_.end()) {
+            fcitx::RawConfig desc;
+            conf.dumpDescription(desc);
+            FlatConfig flat;
+            const auto root = flat.add(-1, "desc", "", "");
+            for (const auto &item: desc.subItems()) {
+                appendRawConfig(flat, *desc.get(item), root);
+            }
+            iter = cache_.emplace(key, std::move(flat)).first;
+        }
+        return iter->second;
+    }
+
+    void clear() {
+        cache_.clear();
+    }
+
+private:
+    std::map<Key, FlatConfig> cache_;
+};
+
+/**
+ * Values of `conf` and its description, as "cfg" and "desc" under root; only values are saved on every call.
+ */
+inline FlatConfig mergeFlatConfigDesc(const fcitx::Configuration &conf, const FlatConfig &desc) {
+    fcitx::RawConfig cfg;
+    conf.save(cfg);
+    FlatConfig flat;
+    const auto root = flat.add(-1, "", "", "");
+    const auto cfgIndex = flat.add(root, "cfg", "", "");
+    for (const auto &item: cfg.subItems()) {
+        appendRawConfig(flat, *cfg.get(item), cfgIndex);
+    }
+    flat.append(root, desc);
+    return flat;
+}
+
+#endif //FCITX5_ANDROID_CONFIG_DESC_CACHE_H
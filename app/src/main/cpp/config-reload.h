@@ -0,0 +1,178 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef FCITX5_ANDROID_CONFIG_RELOAD_H
+#define FCITX5_ANDROID_CONFIG_RELOAD_H
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Modification time and size of files under a directory, by path relative to it.
+ * Only top level entries accepted by a filter are looked into, so that unrelated trees are not walked.
+ */
+class ConfigFileSnapshot {
+public:
+    struct Stamp {
+        uint64_t mtime;
+        uint64_t size;
+
+        bool operator==(const Stamp &other) const { return mtime == other.mtime && size == other.size; }
+
+        bool operator!=(const Stamp &other) const { return !(*this == other); }
+    };
+
+    ConfigFileSnapshot() = default;
+
+    /**
+     * @param accept whether to include a top level file, or the tree of a top level directory, by name
+     */
+    ConfigFileSnapshot(const std::string &root, const std::function<bool(const std::string &)> &accept) {
+        scan(root, "", &accept);
+    }
+
+    /**
+     * @return paths that are added, removed or modified in `newer`
+     */
+    [[nodiscard]] std::vector<std::string> changedIn(const ConfigFileSnapshot &newer) const {
+        std::vector<std::string> changed;
+        auto i = files_.begin();
+        auto j = newer.files_.begin();
+        while (i != files_.end() || j != newer.files_.end()) {
+            if (j == newer.files_.end() || (i != files_.end() && i->first < j->first)) {
+                changed.push_back(i->first);
+                ++i;
+            } else if (i == files_.end() || j->first < i->first) {
+                changed.push_back(j->first);
+                ++j;
+            } else {
+                if (i->second != j->second) {
+                    changed.push_back(i->first);
+                }
+                ++i;
+                ++j;
+            }
+        }
+        return changed;
+    }
+
+private:
+    std::map<std::string, Stamp> files_;
+
+    void scan(const std::string &dir, const std::string &prefix,
+              const std::function<bool(const std::string &)> *accept) {
+        DIR *d = opendir(dir.c_str());
+        if (!d) return;
+        while (const auto *entry = readdir(d)) {
+            const std::string_view name(entry->d_name);
+            if (name == "." || name == "..") continue;
+            if (accept && !(*accept)(entry->d_name)) continue;
+            const auto path = dir + "/" + entry->d_name;
+            const auto relative = prefix + entry->d_name;
+            struct stat st{};
+            if (stat(path.c_str(), &st) != 0) continue;
+            if (S_ISDIR(st.st_mode)) {
+                scan(path, relative + "/", nullptr);
+            } else if (S_ISREG(st.st_mode)) {
+                files_[relative] = {st.st_mtim.tv_sec * 1000000000ULL + st.st_mtim.tv_nsec,
+                                    static_cast<uint64_t>(st.st_size)};
+            }
+        }
+        closedir(d);
+    }
+};
+
+/**
+ * What to reload for a set of changed files in user config and data directories of fcitx.
+ */
+struct ConfigReloadPlan {
+    // global config changed, which every addon may read
+    bool global = false;
+    // input method profile or input method entries changed
+    bool refresh = false;
+    std::set<std::string> addons;
+
+    [[nodiscard]] bool empty() const { return !global && !refresh && addons.empty(); }
+};
+
+inline bool pathStartsWith(std::string_view s, std::string_view prefix) {
+    return s.substr(0, prefix.size()) == prefix;
+}
+
+inline bool pathEndsWith(std::string_view s, std::string_view suffix) {
+    return s.size() >= suffix.size() && s.substr(s.size() - suffix.size()) == suffix;
+}
+
+/**
+ * @return addon that a top level directory in user PkgData directory belongs to,
+ *         eg. pinyin for pinyin/, quickphrase for quickphrase.d/
+ */
+inline std::string dataDirAddon(std::string_view name) {
+    if (pathEndsWith(name, ".d")) {
+        name.remove_suffix(2);
+    }
+    return std::string(name);
+}
+
+/**
+ * top level entries of user PkgConfig directory that planConfigReload looks at
+ */
+inline bool isReloadableConfig(const std::string &name) {
+    return name == "config" || name == "profile" || name == "conf";
+}
+
+/**
+ * top level entries of user PkgData directory that planConfigReload looks at
+ */
+inline bool isReloadableData(const std::string &name, const std::function<bool(const std::string &)> &isAddon) {
+    return name == "inputmethod" || isAddon(dataDirAddon(name));
+}
+
+/**
+ * @param configChanged changed paths relative to user PkgConfig directory
+ * @param dataChanged changed paths relative to user PkgData directory
+ * @param isAddon whether an addon with this name exists
+ */
+inline ConfigReloadPlan planConfigReload(const std::vector<std::string> &configChanged,
+                                         const std::vector<std::string> &dataChanged,
+                                         const std::function<bool(const std::string &)> &isAddon) {
+    ConfigReloadPlan plan;
+    for (const auto &path: configChanged) {
+        if (path == "config") {
+            plan.global = true;
+        } else if (path == "profile") {
+            plan.refresh = true;
+        } else if (pathStartsWith(path, "conf/") && pathEndsWith(path, ".conf")) {
+            // conf/<addon>.conf
+            const auto name = path.substr(5, path.size() - 5 - 5);
+            if (isAddon(name)) {
+                plan.addons.insert(name);
+            }
+        }
+    }
+    for (const auto &path: dataChanged) {
+        if (pathStartsWith(path, "inputmethod/")) {
+            plan.refresh = true;
+            continue;
+        }
+        // first directory names the addon, eg. pinyin/customphrase, table/*.dict, quickphrase.d/*.mb
+        const auto slash = path.find('/');
+        if (slash == std::string::npos) continue;
+        const auto name = dataDirAddon(std::string_view(path).substr(0, slash));
+        if (isAddon(name)) {
+            plan.addons.insert(name);
+        }
+    }
+    return plan;
+}
+
+#endif //FCITX5_ANDROID_CONFIG_RELOAD_H
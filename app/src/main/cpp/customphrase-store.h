@@ -0,0 +1,651 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef FCITX5_ANDROID_CUSTOMPHRASE_STORE_H
+#define FCITX5_ANDROID_CUSTOMPHRASE_STORE_H
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <fcitx-utils/log.h>
+
+#include "customphrase.h"
+
+struct CustomPhraseEntry {
+    std::string_view key;
+    int order;
+    std::string_view value;
+};
+
+/**
+ * Binary store of pinyin custom phrases, for the editor in app.
+ *
+ * The pinyin addon still reads the text file `pinyin/customphrase`, which is imported into the store
+ * when it changes, and exported from the store when the editor saves.
+ *
+ * Base file, memory mapped, all integers are little endian:
+ *   char[4] "FXCP", uint32 version, uint64 mtime and uint64 size of the text file it is synced with,
+ *   uint32 number of records, uint32 size of string pool,
+ *   records sorted by key (stable): uint32 key offset, uint32 key length, int32 order,
+ *                                   uint32 value offset, uint32 value length
+ *   string pool
+ * Opening the store only reads the header, so it costs the same regardless of phrase count.
+ *
+ * Edits are appended to `<path>.log` and replayed on open, until compact() merges them into a new base file.
+ * Every phrase has an id: records in base file are numbered in order, and phrases added later get following ids.
+ * Ids are stable until compaction.
+ *
+ * commitText() marks the log when the text file has caught up with it, so that only edits after the mark are
+ * pending. When they are all additions, they are appended to the text file instead of rewriting it.
+ */
+class CustomPhraseStore {
+public:
+    explicit CustomPhraseStore(std::string path) : path_(std::move(path)), logPath_(path_ + ".log") {}
+
+    /**
+     * map base file and replay edit log
+     * @return false if base file is missing or invalid
+     */
+    bool open() {
+        close();
+        std::unique_ptr<boost::iostreams::mapped_file_source> file;
+        try {
+            file = std::make_unique<boost::iostreams::mapped_file_source>(path_);
+        } catch (const std::exception &) {
+            return false;
+        }
+        const std::string_view data(file->data(), file->size());
+        if (data.size() < HeaderSize || data.substr(0, 4) != std::string_view(Magic, 4) ||
+            readU32(data, 4) != Version) {
+            return false;
+        }
+        const auto count = readU32(data, 24);
+        const auto poolSize = readU32(data, 28);
+        if (data.size() != HeaderSize + static_cast<uint64_t>(count) * RecordSize + poolSize) {
+            return false;
+        }
+        base_ = std::move(file);
+        data_ = data;
+        baseCount_ = count;
+        textMtime_ = readU64(data_, 8);
+        textSize_ = readU64(data_, 16);
+        pool_ = data_.substr(HeaderSize + static_cast<size_t>(count) * RecordSize);
+        replayLog();
+        return true;
+    }
+
+    void close() {
+        base_.reset();
+        data_ = {};
+        pool_ = {};
+        baseCount_ = 0;
+        textMtime_ = 0;
+        textSize_ = 0;
+        textAdded_.clear();
+        textRewrite_ = false;
+        added_.clear();
+        updated_.clear();
+        removed_.clear();
+        liveDirty_ = true;
+        logRecords_ = 0;
+        generation_++;
+    }
+
+    [[nodiscard]] bool isOpen() const { return base_ != nullptr; }
+
+    [[nodiscard]] bool syncedWith(uint64_t textMtime, uint64_t textSize) const {
+        return isOpen() && textMtime_ == textMtime && textSize_ == textSize;
+    }
+
+    /**
+     * stat the text file
+     * @return false if it does not exist, and both are 0
+     */
+    static bool textStamp(const std::string &textPath, uint64_t &mtime, uint64_t &size) {
+        struct stat st{};
+        if (textPath.empty() || ::stat(textPath.c_str(), &st) != 0) {
+            mtime = 0;
+            size = 0;
+            return false;
+        }
+        mtime = st.st_mtim.tv_sec * 1000000000ULL + st.st_mtim.tv_nsec;
+        size = st.st_size;
+        return true;
+    }
+
+    /**
+     * replace the store with phrases from a text file in fcitx custom phrase format
+     */
+    void importText(std::istream &in, uint64_t textMtime, uint64_t textSize) {
+        fcitx::CustomPhraseDict dict;
+        dict.load(in, true);
+        std::vector<OwnedEntry> entries;
+        dict.foreach([&](const std::string &key, std::vector<fcitx::CustomPhrase> &items) {
+            for (const auto &item: items) {
+                entries.push_back({key, item.order(), item.value()});
+            }
+        });
+        // CustomPhraseDict iterates its trie, whose order is not the byte order of keys
+        writeBase(std::move(entries), textMtime, textSize);
+    }
+
+    /**
+     * write live phrases in fcitx custom phrase format
+     */
+    void exportText(std::ostream &out) {
+        fcitx::CustomPhraseDict dict;
+        for (const auto id: live()) {
+            const auto e = entry(id);
+            dict.addPhrase(e.key, e.value, e.order);
+        }
+        dict.save(out);
+    }
+
+    /**
+     * whether there are edits that the text file has not caught up with
+     */
+    [[nodiscard]] bool textPending() const { return textRewrite_ || !textAdded_.empty(); }
+
+    /**
+     * bring the text file at `textPath` up to date with the store. If phrases have only been added since
+     * last commit, and the file is still the one committed, they are appended to it; otherwise the whole
+     * file is rewritten.
+     */
+    void commitText(const std::string &textPath) {
+        if (!textPending()) return;
+        uint64_t mtime;
+        uint64_t size;
+        if (!textRewrite_ && textStamp(textPath, mtime, size) && syncedWith(mtime, size)) {
+            appendText(textPath, size);
+        } else {
+            rewriteText(textPath);
+        }
+        textStamp(textPath, mtime, size);
+        // mark the log before the header, if this is interrupted in between, the header does not match
+        // the text file, which is then imported again, instead of having pending edits appended twice
+        appendLog(std::string(1, static_cast<char>(Op::Commit)));
+        textAdded_.clear();
+        textRewrite_ = false;
+        writeTextStamp(mtime, size);
+    }
+
+    /**
+     * ids of live phrases, in base file order followed by phrases added later
+     */
+    const std::vector<uint32_t> &live() {
+        if (liveDirty_) {
+            live_.clear();
+            live_.reserve(baseCount_ + added_.size());
+            for (uint32_t id = 0; id < baseCount_ + added_.size(); id++) {
+                if (removed_.count(id) == 0) {
+                    live_.push_back(id);
+                }
+            }
+            liveDirty_ = false;
+        }
+        return live_;
+    }
+
+    [[nodiscard]] size_t size() { return live().size(); }
+
+    [[nodiscard]] bool contains(uint32_t id) const {
+        return id < baseCount_ + added_.size() && removed_.count(id) == 0;
+    }
+
+    [[nodiscard]] CustomPhraseEntry entry(uint32_t id) const {
+        if (id >= baseCount_) {
+            return added_[id - baseCount_].view();
+        }
+        if (auto iter = updated_.find(id); iter != updated_.end()) {
+            return iter->second.view();
+        }
+        const size_t offset = HeaderSize + static_cast<size_t>(id) * RecordSize;
+        return {pool_.substr(readU32(data_, offset), readU32(data_, offset + 4)),
+                static_cast<int32_t>(readU32(data_, offset + 8)),
+                pool_.substr(readU32(data_, offset + 12), readU32(data_, offset + 16))};
+    }
+
+    /**
+     * ids of live phrases with exactly `key`, found by binary search in base file
+     */
+    [[nodiscard]] std::vector<uint32_t> find(std::string_view key) const {
+        std::vector<uint32_t> result;
+        uint32_t low = 0;
+        uint32_t high = baseCount_;
+        while (low < high) {
+            const uint32_t mid = low + (high - low) / 2;
+            if (baseKey(mid) < key) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        for (uint32_t id = low; id < baseCount_ && baseKey(id) == key; id++) {
+            if (contains(id) && updated_.count(id) == 0) {
+                result.push_back(id);
+            }
+        }
+        for (const auto &[id, e]: updated_) {
+            if (contains(id) && e.key == key) {
+                result.push_back(id);
+            }
+        }
+        for (uint32_t i = 0; i < added_.size(); i++) {
+            const uint32_t id = baseCount_ + i;
+            if (contains(id) && added_[i].key == key) {
+                result.push_back(id);
+            }
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    /**
+     * ids of live phrases whose key starts with `keyPrefix` and value contains `valueSubstring`, in the same
+     * order as live(). Matching keys in base file are found by binary search.
+     */
+    [[nodiscard]] std::vector<uint32_t> query(std::string_view keyPrefix, std::string_view valueSubstring) const {
+        const auto matches = [&](const CustomPhraseEntry &e) {
+            return e.key.substr(0, keyPrefix.size()) == keyPrefix &&
+                   (valueSubstring.empty() || e.value.find(valueSubstring) != std::string_view::npos);
+        };
+        std::vector<uint32_t> result;
+        uint32_t low = 0;
+        uint32_t high = baseCount_;
+        while (low < high) {
+            const uint32_t mid = low + (high - low) / 2;
+            if (baseKey(mid) < keyPrefix) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        for (uint32_t id = low; id < baseCount_ && baseKey(id).substr(0, keyPrefix.size()) == keyPrefix; id++) {
+            if (contains(id) && updated_.count(id) == 0 && matches(entry(id))) {
+                result.push_back(id);
+            }
+        }
+        for (const auto &[id, e]: updated_) {
+            if (contains(id) && matches(e.view())) {
+                result.push_back(id);
+            }
+        }
+        for (uint32_t i = 0; i < added_.size(); i++) {
+            const uint32_t id = baseCount_ + i;
+            if (contains(id) && matches(added_[i].view())) {
+                result.push_back(id);
+            }
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    /**
+     * changes whenever phrases or their ids may have changed
+     */
+    [[nodiscard]] uint64_t generation() const { return generation_; }
+
+    uint32_t add(std::string_view key, int order, std::string_view value) {
+        std::string record(1, static_cast<char>(Op::Add));
+        appendEntry(record, key, order, value);
+        appendLog(record);
+        return applyAdd(key, order, value);
+    }
+
+    bool remove(uint32_t id) {
+        if (!contains(id)) return false;
+        std::string record(1, static_cast<char>(Op::Remove));
+        appendU32(record, id);
+        appendLog(record);
+        applyRemove(id);
+        return true;
+    }
+
+    bool update(uint32_t id, std::string_view key, int order, std::string_view value) {
+        if (!contains(id)) return false;
+        std::string record(1, static_cast<char>(Op::Update));
+        appendU32(record, id);
+        appendEntry(record, key, order, value);
+        appendLog(record);
+        applyUpdate(id, key, order, value);
+        return true;
+    }
+
+    /**
+     * whether edit log has grown large enough, compared to base file, to be worth compacting
+     */
+    [[nodiscard]] bool shouldCompact() const {
+        // compaction discards the log, which tells which edits the text file has not caught up with
+        return logRecords_ > 1024 && logRecords_ > baseCount_ / 4 && !textPending();
+    }
+
+    /**
+     * merge edit log into a new base file; ids of phrases change
+     */
+    void compact() {
+        std::vector<OwnedEntry> entries;
+        for (const auto id: live()) {
+            const auto e = entry(id);
+            entries.push_back({std::string(e.key), e.order, std::string(e.value)});
+        }
+        writeBase(std::move(entries), textMtime_, textSize_);
+    }
+
+private:
+    struct OwnedEntry {
+        std::string key;
+        int order;
+        std::string value;
+
+        [[nodiscard]] CustomPhraseEntry view() const { return {key, order, value}; }
+    };
+
+    enum class Op : uint8_t {
+        Add = 1,
+        Remove = 2,
+        Update = 3,
+        // text file has caught up with edits before this
+        Commit = 4
+    };
+
+    static constexpr char Magic[4] = {'F', 'X', 'C', 'P'};
+    static constexpr uint32_t Version = 1;
+    static constexpr size_t HeaderSize = 32;
+    static constexpr size_t RecordSize = 20;
+
+    std::string path_;
+    std::string logPath_;
+    std::unique_ptr<boost::iostreams::mapped_file_source> base_;
+    std::string_view data_;
+    std::string_view pool_;
+    uint32_t baseCount_ = 0;
+    // stamp of the text file in sync with the store, as in header
+    uint64_t textMtime_ = 0;
+    uint64_t textSize_ = 0;
+    // ids added since last commit, in order
+    std::vector<uint32_t> textAdded_;
+    // phrases in text file have been removed or updated since last commit
+    bool textRewrite_ = false;
+    std::deque<OwnedEntry> added_;
+    std::unordered_map<uint32_t, OwnedEntry> updated_;
+    std::unordered_set<uint32_t> removed_;
+    std::vector<uint32_t> live_;
+    bool liveDirty_ = true;
+    size_t logRecords_ = 0;
+    uint64_t generation_ = 0;
+
+    static uint32_t readU32(std::string_view data, size_t offset) {
+        uint32_t value = 0;
+        for (size_t i = 0; i < 4; i++) {
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(data[offset + i])) << (8 * i);
+        }
+        return value;
+    }
+
+    static uint64_t readU64(std::string_view data, size_t offset) {
+        return readU32(data, offset) | (static_cast<uint64_t>(readU32(data, offset + 4)) << 32);
+    }
+
+    static void writeU32(char *buf, uint32_t value) {
+        for (size_t i = 0; i < 4; i++) {
+            buf[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+        }
+    }
+
+    static void writeU64(char *buf, uint64_t value) {
+        writeU32(buf, static_cast<uint32_t>(value));
+        writeU32(buf + 4, static_cast<uint32_t>(value >> 32));
+    }
+
+    static void appendU32(std::string &out, uint32_t value) {
+        char buf[4];
+        writeU32(buf, value);
+        out.append(buf, sizeof(buf));
+    }
+
+    static void appendEntry(std::string &out, std::string_view key, int order, std::string_view value) {
+        appendU32(out, static_cast<uint32_t>(key.size()));
+        out.append(key);
+        appendU32(out, static_cast<uint32_t>(order));
+        appendU32(out, static_cast<uint32_t>(value.size()));
+        out.append(value);
+    }
+
+    [[nodiscard]] std::string_view baseKey(uint32_t id) const {
+        const size_t offset = HeaderSize + static_cast<size_t>(id) * RecordSize;
+        return pool_.substr(readU32(data_, offset), readU32(data_, offset + 4));
+    }
+
+    uint32_t applyAdd(std::string_view key, int order, std::string_view value) {
+        added_.push_back({std::string(key), order, std::string(value)});
+        liveDirty_ = true;
+        generation_++;
+        const auto id = baseCount_ + static_cast<uint32_t>(added_.size() - 1);
+        textAdded_.push_back(id);
+        return id;
+    }
+
+    /**
+     * an edit of `id` needs the text file rewritten, unless `id` has not been committed yet
+     */
+    void touchText(uint32_t id, bool removing) {
+        const auto iter = std::find(textAdded_.begin(), textAdded_.end(), id);
+        if (iter == textAdded_.end()) {
+            textRewrite_ = true;
+        } else if (removing) {
+            textAdded_.erase(iter);
+        }
+    }
+
+    void applyRemove(uint32_t id) {
+        touchText(id, true);
+        removed_.insert(id);
+        updated_.erase(id);
+        liveDirty_ = true;
+        generation_++;
+    }
+
+    void applyUpdate(uint32_t id, std::string_view key, int order, std::string_view value) {
+        touchText(id, false);
+        OwnedEntry e{std::string(key), order, std::string(value)};
+        if (id >= baseCount_) {
+            added_[id - baseCount_] = std::move(e);
+        } else {
+            updated_[id] = std::move(e);
+        }
+        generation_++;
+    }
+
+    void appendLog(const std::string &record) {
+        const int fd = ::open(logPath_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open " + logPath_ + ": " + std::strerror(errno));
+        }
+        const auto n = ::write(fd, record.data(), record.size());
+        ::close(fd);
+        if (n != static_cast<ssize_t>(record.size())) {
+            throw std::runtime_error("Cannot write " + logPath_);
+        }
+        logRecords_++;
+    }
+
+    void replayLog() {
+        std::ifstream in(logPath_, std::ios::in | std::ios::binary);
+        if (!in) return;
+        const std::string log((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        const std::string_view view(log);
+        size_t pos = 0;
+        const auto has = [&](size_t n) { return pos + n <= view.size(); };
+        const auto readString = [&](std::string_view &s) {
+            if (!has(4)) return false;
+            const auto length = readU32(view, pos);
+            pos += 4;
+            if (!has(length)) return false;
+            s = view.substr(pos, length);
+            pos += length;
+            return true;
+        };
+        const auto readEntry = [&](std::string_view &key, int &order, std::string_view &value) {
+            if (!readString(key) || !has(4)) return false;
+            order = static_cast<int32_t>(readU32(view, pos));
+            pos += 4;
+            return readString(value);
+        };
+        while (has(1)) {
+            const auto op = static_cast<Op>(view[pos++]);
+            std::string_view key;
+            std::string_view value;
+            int order = 0;
+            uint32_t id = 0;
+            if (op == Op::Remove || op == Op::Update) {
+                if (!has(4)) break;
+                id = readU32(view, pos);
+                pos += 4;
+            }
+            if ((op == Op::Add || op == Op::Update) && !readEntry(key, order, value)) {
+                break;
+            }
+            if (op == Op::Commit) {
+                textAdded_.clear();
+                textRewrite_ = false;
+            } else if (op == Op::Add) {
+                applyAdd(key, order, value);
+            } else if (op == Op::Remove && contains(id)) {
+                applyRemove(id);
+            } else if (op == Op::Update && contains(id)) {
+                applyUpdate(id, key, order, value);
+            } else if (op != Op::Remove && op != Op::Update && op != Op::Commit) {
+                FCITX_WARN() << "Corrupted custom phrase log at " << pos;
+                break;
+            }
+            logRecords_++;
+        }
+    }
+
+    /**
+     * record the text file that the store is in sync with, in header and in memory,
+     * the mapping is left as is since it never reads the stamp again
+     */
+    void writeTextStamp(uint64_t textMtime, uint64_t textSize) {
+        textMtime_ = textMtime;
+        textSize_ = textSize;
+        const int fd = ::open(path_.c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd < 0) return;
+        char buf[16];
+        writeU64(buf, textMtime);
+        writeU64(buf + 8, textSize);
+        ::pwrite(fd, buf, sizeof(buf), 8);
+        ::close(fd);
+    }
+
+    void appendText(const std::string &textPath, uint64_t textSize) {
+        fcitx::CustomPhraseDict dict;
+        for (const auto id: textAdded_) {
+            const auto e = entry(id);
+            dict.addPhrase(e.key, e.value, e.order);
+        }
+        bool endsWithNewLine = textSize == 0;
+        if (!endsWithNewLine) {
+            std::ifstream in(textPath, std::ios::in | std::ios::binary);
+            in.seekg(-1, std::ios::end);
+            endsWithNewLine = in.get() == '\n';
+        }
+        std::ofstream out(textPath, std::ios::out | std::ios::binary | std::ios::app);
+        if (!endsWithNewLine) {
+            out.put('\n');
+        }
+        dict.save(out);
+        if (!out.flush()) {
+            throw std::runtime_error("Cannot write " + textPath);
+        }
+    }
+
+    void rewriteText(const std::string &textPath) {
+        const auto tempPath = textPath + ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+            exportText(out);
+            if (!out.flush()) {
+                std::remove(tempPath.c_str());
+                throw std::runtime_error("Cannot write " + tempPath);
+            }
+        }
+        if (std::rename(tempPath.c_str(), textPath.c_str()) != 0) {
+            throw std::runtime_error("Cannot replace " + textPath + ": " + std::strerror(errno));
+        }
+    }
+
+    /**
+     * write `entries` as new base file, and discard edit log.
+     * Entries are sorted by key first, since find() and query() binary search the base file;
+     * the sort is stable, so phrases with the same key keep their order.
+     */
+    void writeBase(std::vector<OwnedEntry> entries, uint64_t textMtime, uint64_t textSize) {
+        std::stable_sort(entries.begin(), entries.end(), [](const OwnedEntry &a, const OwnedEntry &b) {
+            return a.key < b.key;
+        });
+        std::string records;
+        records.reserve(entries.size() * RecordSize);
+        std::string pool;
+        for (const auto &e: entries) {
+            appendU32(records, static_cast<uint32_t>(pool.size()));
+            appendU32(records, static_cast<uint32_t>(e.key.size()));
+            pool.append(e.key);
+            appendU32(records, static_cast<uint32_t>(e.order));
+            appendU32(records, static_cast<uint32_t>(pool.size()));
+            appendU32(records, static_cast<uint32_t>(e.value.size()));
+            pool.append(e.value);
+        }
+        char header[HeaderSize];
+        std::memcpy(header, Magic, sizeof(Magic));
+        writeU32(header + 4, Version);
+        writeU64(header + 8, textMtime);
+        writeU64(header + 16, textSize);
+        writeU32(header + 24, static_cast<uint32_t>(entries.size()));
+        writeU32(header + 28, static_cast<uint32_t>(pool.size()));
+        const auto tempPath = path_ + ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+            out.write(header, sizeof(header));
+            out.write(records.data(), static_cast<std::streamsize>(records.size()));
+            out.write(pool.data(), static_cast<std::streamsize>(pool.size()));
+            if (!out.flush()) {
+                std::remove(tempPath.c_str());
+                throw std::runtime_error("Cannot write " + tempPath);
+            }
+        }
+        close();
+        if (std::rename(tempPath.c_str(), path_.c_str()) != 0) {
+            throw std::runtime_error("Cannot replace " + path_ + ": " + std::strerror(errno));
+        }
+        std::remove(logPath_.c_str());
+        if (!open()) {
+            throw std::runtime_error("Cannot open " + path_);
+        }
+    }
+};
+
+#endif //FCITX5_ANDROID_CUSTOMPHRASE_STORE_H
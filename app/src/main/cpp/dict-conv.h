@@ -0,0 +1,413 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef FCITX5_ANDROID_DICT_CONV_H
+#define FCITX5_ANDROID_DICT_CONV_H
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <istream>
+#include <memory>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcitx-utils/log.h>
+
+#include <libime/core/datrie.h>
+#include <libime/pinyin/pinyindictionary.h>
+#include <libime/pinyin/pinyinencoder.h>
+
+/**
+ * @param processed amount of work done, in the same unit as `total`
+ * @return false to cancel the conversion
+ */
+typedef std::function<bool(uint64_t processed, uint64_t total)> DictConvProgressCallback;
+
+class DictConvCancelled : public std::runtime_error {
+public:
+    DictConvCancelled() : std::runtime_error("Conversion cancelled") {}
+};
+
+/**
+ * Throttles progress reports, and turns a cancel request into DictConvCancelled.
+ * Must be used on the thread that owns the callback, since it may call into JVM.
+ */
+class DictConvProgress {
+public:
+    DictConvProgress(DictConvProgressCallback callback, uint64_t total)
+            : callback_(std::move(callback)), total_(total) {}
+
+    void report(uint64_t processed) {
+        // report at most every 1/256 of total, plus the final one
+        if (!callback_ || (processed < total_ && processed - last_ < total_ / 256)) {
+            return;
+        }
+        last_ = processed;
+        if (!callback_(processed, total_)) {
+            throw DictConvCancelled();
+        }
+    }
+
+    void finish() { report(total_); }
+
+private:
+    DictConvProgressCallback callback_;
+    uint64_t total_;
+    uint64_t last_ = 0;
+};
+
+/**
+ * Reads a file through a large buffer, and reports bytes consumed to DictConvProgress.
+ *
+ * istream swallows exceptions thrown by its streambuf, so a cancel request ends the stream instead,
+ * and throwIfCancelled() should be called after the stream has been consumed.
+ */
+class DictConvSource : public std::streambuf {
+public:
+    DictConvSource(const std::string &path, DictConvProgressCallback callback, size_t bufferSize = 1 << 18)
+            : buffer_(bufferSize) {
+        fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0) {
+            throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+        }
+        struct stat st{};
+        if (::fstat(fd_, &st) != 0) {
+            const std::string error = std::strerror(errno);
+            ::close(fd_);
+            throw std::runtime_error("Cannot stat " + path + ": " + error);
+        }
+        progress_ = std::make_unique<DictConvProgress>(std::move(callback), static_cast<uint64_t>(st.st_size));
+    }
+
+    DictConvSource(const DictConvSource &) = delete;
+
+    ~DictConvSource() override { ::close(fd_); }
+
+    void throwIfCancelled() const {
+        if (cancelled_) {
+            throw DictConvCancelled();
+        }
+    }
+
+    void finish() { progress_->finish(); }
+
+protected:
+    int_type underflow() override {
+        if (cancelled_) {
+            return traits_type::eof();
+        }
+        try {
+            progress_->report(consumed_);
+        } catch (const DictConvCancelled &) {
+            cancelled_ = true;
+            return traits_type::eof();
+        }
+        ssize_t n;
+        do {
+            n = ::read(fd_, buffer_.data(), buffer_.size());
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) {
+            return traits_type::eof();
+        }
+        consumed_ += n;
+        setg(buffer_.data(), buffer_.data(), buffer_.data() + n);
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    int fd_;
+    std::vector<char> buffer_;
+    std::unique_ptr<DictConvProgress> progress_;
+    uint64_t consumed_ = 0;
+    bool cancelled_ = false;
+};
+
+/**
+ * Writes a file through a large buffer; writes larger than the buffer bypass it.
+ * close() must be called to find out whether everything has been written.
+ */
+class DictConvSink : public std::streambuf {
+public:
+    explicit DictConvSink(const std::string &path, size_t bufferSize = 1 << 18) : buffer_(bufferSize) {
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+        }
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+    }
+
+    DictConvSink(const DictConvSink &) = delete;
+
+    ~DictConvSink() override {
+        if (fd_ >= 0) {
+            flush();
+            ::close(fd_);
+        }
+    }
+
+    void close() {
+        const bool flushed = flush();
+        const bool closed = ::close(fd_) == 0;
+        fd_ = -1;
+        if (!flushed || !closed) {
+            throw std::runtime_error(std::string("Cannot write dictionary: ") + std::strerror(errno));
+        }
+    }
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (!flush()) {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) override {
+        if (n < epptr() - pptr()) {
+            std::memcpy(pptr(), s, n);
+            pbump(static_cast<int>(n));
+            return n;
+        }
+        if (!flush() || !writeAll(s, static_cast<size_t>(n))) {
+            return 0;
+        }
+        return n;
+    }
+
+    int sync() override { return flush() ? 0 : -1; }
+
+private:
+    int fd_;
+    std::vector<char> buffer_;
+
+    bool writeAll(const char *data, size_t size) {
+        while (size > 0) {
+            const auto n = ::write(fd_, data, size);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    bool flush() {
+        const bool ok = writeAll(pbase(), pptr() - pbase());
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+        return ok;
+    }
+};
+
+inline size_t dictConvThreads() {
+    const size_t n = std::thread::hardware_concurrency();
+    return std::clamp<size_t>(n, 1, 4);
+}
+
+/**
+ * Reads `in` in chunks of whole lines and parses every chunk with `parse` on worker threads.
+ * Results are handed to `merge` in input order on the calling thread.
+ * At most `threads * 2` chunks are in flight, so memory usage does not grow with input size.
+ */
+template<typename Result>
+void parallelParseLines(std::istream &in,
+                        const std::function<Result(std::string_view)> &parse,
+                        const std::function<void(Result &)> &merge,
+                        DictConvProgress &progress,
+                        size_t threads = dictConvThreads(),
+                        size_t chunkSize = 1 << 20) {
+    std::deque<std::pair<std::future<Result>, uint64_t>> inFlight;
+    std::string carry;
+    uint64_t consumed = 0;
+    auto drainOne = [&]() {
+        auto [future, offset] = std::move(inFlight.front());
+        inFlight.pop_front();
+        auto result = future.get();
+        merge(result);
+        progress.report(offset);
+    };
+    try {
+        while (in) {
+            std::string chunk = std::move(carry);
+            carry.clear();
+            const auto head = chunk.size();
+            chunk.resize(head + chunkSize);
+            in.read(chunk.data() + head, static_cast<std::streamsize>(chunkSize));
+            const auto got = static_cast<size_t>(in.gcount());
+            chunk.resize(head + got);
+            consumed += got;
+            if (in) {
+                // keep the incomplete last line for next chunk
+                const auto lastNewLine = chunk.rfind('\n');
+                if (lastNewLine == std::string::npos) {
+                    carry = std::move(chunk);
+                    continue;
+                }
+                carry.assign(chunk, lastNewLine + 1, std::string::npos);
+                chunk.resize(lastNewLine + 1);
+            }
+            if (chunk.empty()) {
+                continue;
+            }
+            inFlight.emplace_back(std::async(std::launch::async, [&parse, data = std::move(chunk)]() {
+                return parse(data);
+            }), consumed - carry.size());
+            if (inFlight.size() >= threads * 2) {
+                drainOne();
+            }
+        }
+        while (!inFlight.empty()) {
+            drainOne();
+        }
+    } catch (...) {
+        // workers reference `parse`, wait for them before unwinding
+        for (auto &item: inFlight) {
+            item.first.wait();
+        }
+        throw;
+    }
+    progress.finish();
+}
+
+template<typename F>
+void forEachLine(std::string_view data, F &&callback) {
+    size_t start = 0;
+    while (start < data.size()) {
+        auto end = data.find('\n', start);
+        if (end == std::string_view::npos) {
+            end = data.size();
+        }
+        callback(data.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+/**
+ * split `line` by whitespace characters, like boost::split without token_compress
+ * @return number of tokens, or SIZE_MAX if there are more than `N`
+ */
+template<size_t N>
+size_t splitTokens(std::string_view line, std::array<std::string_view, N> &tokens) {
+    static constexpr std::string_view whitespace = " \n\t\r\v\f";
+    const auto first = line.find_first_not_of(whitespace);
+    if (first == std::string_view::npos) {
+        return 0;
+    }
+    line = line.substr(first, line.find_last_not_of(whitespace) - first + 1);
+    size_t count = 0;
+    size_t start = 0;
+    while (true) {
+        if (count == N) {
+            return SIZE_MAX;
+        }
+        const auto end = line.find_first_of(whitespace, start);
+        tokens[count++] = line.substr(start, end == std::string_view::npos ? end : end - start);
+        if (end == std::string_view::npos) {
+            return count;
+        }
+        start = end + 1;
+    }
+}
+
+/**
+ * Pinyin dictionary entries encoded as libime trie keys, packed in a single buffer
+ */
+struct EncodedPinyinChunk {
+    std::string keys;
+    std::vector<std::pair<uint32_t, uint32_t>> spans;
+    std::vector<float> costs;
+    size_t invalid = 0;
+
+    std::string_view key(size_t i) const {
+        return std::string_view(keys).substr(spans[i].first, spans[i].second);
+    }
+};
+
+// separator between encoded pinyin and hanzi in libime trie keys, same as libime's pinyinHanziSep
+constexpr char PinyinHanziSep = '!';
+
+inline void encodePinyinEntry(EncodedPinyinChunk &chunk, std::string_view hanzi, std::string_view pinyin, float cost) {
+    const auto encoded = libime::PinyinEncoder::encodeFullPinyin(pinyin);
+    const auto offset = static_cast<uint32_t>(chunk.keys.size());
+    chunk.keys.append(encoded.data(), encoded.size());
+    chunk.keys.push_back(PinyinHanziSep);
+    chunk.keys.append(hanzi);
+    chunk.spans.emplace_back(offset, static_cast<uint32_t>(chunk.keys.size() - offset));
+    chunk.costs.push_back(cost);
+}
+
+/**
+ * parse lines in libime pinyin text format: "hanzi pinyin [cost]"
+ */
+inline EncodedPinyinChunk parsePinyinTextChunk(std::string_view data) {
+    EncodedPinyinChunk chunk;
+    chunk.keys.reserve(data.size());
+    std::array<std::string_view, 3> tokens;
+    forEachLine(data, [&](std::string_view line) {
+        const auto count = splitTokens(line, tokens);
+        if (count != 2 && count != 3) {
+            return;
+        }
+        float cost = 0.0F;
+        try {
+            if (count == 3) {
+                cost = std::stof(std::string(tokens[2]));
+            }
+            encodePinyinEntry(chunk, tokens[0], tokens[1], cost);
+        } catch (const std::exception &) {
+            chunk.invalid++;
+        }
+    });
+    return chunk;
+}
+
+/**
+ * Stream a text pinyin dictionary into `trie`, encoding entries on worker threads.
+ * Entries already in `trie` are overwritten.
+ */
+inline void addPinyinTextToTrie(libime::DATrie<float> &trie, std::istream &in, DictConvProgress &progress) {
+    size_t invalid = 0;
+    parallelParseLines<EncodedPinyinChunk>(
+            in, parsePinyinTextChunk,
+            [&](EncodedPinyinChunk &chunk) {
+                for (size_t i = 0; i < chunk.spans.size(); i++) {
+                    trie.set(chunk.key(i), chunk.costs[i]);
+                }
+                invalid += chunk.invalid;
+            },
+            progress);
+    if (invalid) {
+        FCITX_WARN() << "Skipped " << invalid << " invalid pinyin dictionary entries";
+    }
+}
+
+/**
+ * Save `trie` as libime binary pinyin dictionary
+ */
+inline void savePinyinTrie(libime::DATrie<float> trie, std::ostream &out) {
+    libime::PinyinDictionary dict;
+    dict.setTrie(libime::PinyinDictionary::SystemDict, std::make_unique<libime::DATrie<float>>(std::move(trie)));
+    dict.save(libime::PinyinDictionary::SystemDict, out, libime::PinyinDictFormat::Binary);
+}
+
+#endif //FCITX5_ANDROID_DICT_CONV_H
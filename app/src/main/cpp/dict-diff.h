@@ -0,0 +1,205 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef FCITX5_ANDROID_DICT_DIFF_H
+#define FCITX5_ANDROID_DICT_DIFF_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <libime/core/datrie.h>
+
+/**
+ * Diff between two snapshots of a libime pinyin dictionary trie.
+ *
+ * Format, all integers are little endian:
+ *   magic "FXDD", uint32 version
+ *   uint64 hash of base entries, uint64 hash of result entries
+ *   uint32 number of removed keys, then for each: uint32 length, key bytes
+ *   uint32 number of added or re-weighted entries, then for each: uint32 length, key bytes, float32 value
+ * Keys are sorted bytewise, so the same pair of snapshots always produces the same diff.
+ */
+typedef std::vector<std::pair<std::string, float>> DictDiffEntries;
+
+class DictDiffError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+namespace dict_diff {
+
+constexpr char Magic[4] = {'F', 'X', 'D', 'D'};
+constexpr uint32_t Version = 1;
+
+inline DictDiffEntries trieEntries(const libime::DATrie<float> &trie) {
+    DictDiffEntries entries;
+    std::string key;
+    trie.foreach([&](float value, size_t len, libime::DATrie<float>::position_type pos) {
+        trie.suffix(key, len, pos);
+        entries.emplace_back(key, value);
+        return true;
+    });
+    std::sort(entries.begin(), entries.end());
+    return entries;
+}
+
+/**
+ * FNV-1a over sorted entries
+ */
+inline uint64_t hashEntries(const DictDiffEntries &entries) {
+    uint64_t hash = 0xcbf29ce484222325;
+    const auto feed = [&](const void *data, size_t size) {
+        const auto *p = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ p[i]) * 0x100000001b3;
+        }
+    };
+    for (const auto &[key, value]: entries) {
+        const auto length = static_cast<uint32_t>(key.size());
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        feed(&length, sizeof(length));
+        feed(key.data(), key.size());
+        feed(&bits, sizeof(bits));
+    }
+    return hash;
+}
+
+template<typename T>
+void writeLE(std::ostream &out, T value) {
+    char buf[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); i++) {
+        buf[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+    out.write(buf, sizeof(T));
+}
+
+template<typename T>
+T readLE(std::istream &in) {
+    unsigned char buf[sizeof(T)];
+    if (!in.read(reinterpret_cast<char *>(buf), sizeof(T))) {
+        throw DictDiffError("Unexpected end of dictionary diff");
+    }
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        value |= static_cast<T>(buf[i]) << (8 * i);
+    }
+    return value;
+}
+
+inline void writeKey(std::ostream &out, const std::string &key) {
+    writeLE<uint32_t>(out, static_cast<uint32_t>(key.size()));
+    out.write(key.data(), static_cast<std::streamsize>(key.size()));
+}
+
+inline std::string readKey(std::istream &in) {
+    const auto length = readLE<uint32_t>(in);
+    std::string key(length, '\0');
+    if (!in.read(key.data(), length)) {
+        throw DictDiffError("Unexpected end of dictionary diff");
+    }
+    return key;
+}
+
+inline void writeValue(std::ostream &out, float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    writeLE(out, bits);
+}
+
+inline float readValue(std::istream &in) {
+    const auto bits = readLE<uint32_t>(in);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+} // namespace dict_diff
+
+/**
+ * @return number of changed entries
+ */
+inline size_t writeDictDiff(const libime::DATrie<float> &base, const libime::DATrie<float> &result, std::ostream &out) {
+    using namespace dict_diff;
+    const auto from = trieEntries(base);
+    const auto to = trieEntries(result);
+    std::vector<const std::string *> removed;
+    std::vector<const std::pair<std::string, float> *> upserted;
+    auto i = from.begin();
+    auto j = to.begin();
+    while (i != from.end() || j != to.end()) {
+        if (j == to.end() || (i != from.end() && i->first < j->first)) {
+            removed.push_back(&i->first);
+            ++i;
+        } else if (i == from.end() || j->first < i->first) {
+            upserted.push_back(&*j);
+            ++j;
+        } else {
+            // compare bits rather than value, so that a diff never loses a change
+            if (std::memcmp(&i->second, &j->second, sizeof(float)) != 0) {
+                upserted.push_back(&*j);
+            }
+            ++i;
+            ++j;
+        }
+    }
+    out.write(Magic, sizeof(Magic));
+    writeLE(out, Version);
+    writeLE(out, hashEntries(from));
+    writeLE(out, hashEntries(to));
+    writeLE<uint32_t>(out, static_cast<uint32_t>(removed.size()));
+    for (const auto *key: removed) {
+        writeKey(out, *key);
+    }
+    writeLE<uint32_t>(out, static_cast<uint32_t>(upserted.size()));
+    for (const auto *entry: upserted) {
+        writeKey(out, entry->first);
+        writeValue(out, entry->second);
+    }
+    if (!out) {
+        throw DictDiffError("Cannot write dictionary diff");
+    }
+    return removed.size() + upserted.size();
+}
+
+/**
+ * Apply a diff produced by writeDictDiff to `trie`, which must have the same entries as the base snapshot.
+ * `trie` is verified to match the result snapshot afterwards.
+ */
+inline void applyDictDiff(libime::DATrie<float> &trie, std::istream &in) {
+    using namespace dict_diff;
+    char magic[sizeof(Magic)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, Magic, sizeof(Magic)) != 0) {
+        throw DictDiffError("Not a dictionary diff");
+    }
+    if (readLE<uint32_t>(in) != Version) {
+        throw DictDiffError("Unsupported dictionary diff version");
+    }
+    const auto baseHash = readLE<uint64_t>(in);
+    const auto resultHash = readLE<uint64_t>(in);
+    if (hashEntries(trieEntries(trie)) != baseHash) {
+        throw DictDiffError("Dictionary does not match the base of diff");
+    }
+    const auto removed = readLE<uint32_t>(in);
+    for (uint32_t i = 0; i < removed; i++) {
+        trie.erase(readKey(in));
+    }
+    const auto upserted = readLE<uint32_t>(in);
+    for (uint32_t i = 0; i < upserted; i++) {
+        const auto key = readKey(in);
+        trie.set(key, readValue(in));
+    }
+    if (hashEntries(trieEntries(trie)) != resultHash) {
+        throw DictDiffError("Patched dictionary does not match the result of diff");
+    }
+}
+
+#endif //FCITX5_ANDROID_DICT_DIFF_H
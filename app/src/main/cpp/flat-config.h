@@ -0,0 +1,151 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef FCITX5_ANDROID_FLAT_CONFIG_H
+#define FCITX5_ANDROID_FLAT_CONFIG_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcitx-config/rawconfig.h>
+
+/**
+ * Config tree flattened in pre-order, to be passed across JNI as two arrays rather than one object per node.
+ *
+ * Every node takes NodeSize ints: parent index (-1 for root), then offset and length in bytes of name, comment
+ * and value in a UTF-8 string pool. A parent always comes before its children, and children keep their order.
+ * Value length is -1 for a node whose value should be ignored, because it has sub items (maybe none).
+ * See RawConfig.fromFlat and RawConfig.flatten on Kotlin side.
+ */
+class FlatConfig {
+public:
+    static constexpr size_t NodeSize = 7;
+
+    FlatConfig() = default;
+
+    /**
+     * @throw std::invalid_argument if `nodes` is not a valid node table over `pool`
+     */
+    FlatConfig(std::vector<int32_t> nodes, std::string pool) : nodes_(std::move(nodes)), pool_(std::move(pool)) {
+        if (nodes_.empty() || nodes_.size() % NodeSize != 0 || nodes_[0] != -1) {
+            throw std::invalid_argument("Invalid flat config");
+        }
+        const auto validSpan = [&](size_t offset, bool allowNone) {
+            const int64_t begin = nodes_[offset];
+            const int64_t length = nodes_[offset + 1];
+            return (allowNone && length == -1) ||
+                   (begin >= 0 && length >= 0 && begin + length <= static_cast<int64_t>(pool_.size()));
+        };
+        for (size_t i = 0; i < size(); i++) {
+            const auto base = i * NodeSize;
+            if ((i > 0 && (nodes_[base] < 0 || static_cast<size_t>(nodes_[base]) >= i)) ||
+                !validSpan(base + 1, false) || !validSpan(base + 3, false) || !validSpan(base + 5, true)) {
+                throw std::invalid_argument("Invalid flat config");
+            }
+        }
+    }
+
+    int32_t add(int32_t parent, std::string_view name, std::string_view comment, std::string_view value) {
+        const auto index = static_cast<int32_t>(size());
+        nodes_.push_back(parent);
+        appendString(name);
+        appendString(comment);
+        appendString(value);
+        return index;
+    }
+
+    /**
+     * append all nodes of `other` after existing ones, with root of `other` under `parent`
+     */
+    void append(int32_t parent, const FlatConfig &other) {
+        const auto indexOffset = static_cast<int32_t>(size());
+        const auto poolOffset = static_cast<int32_t>(pool_.size());
+        nodes_.reserve(nodes_.size() + other.nodes_.size());
+        for (size_t i = 0; i < other.size(); i++) {
+            const auto *node = &other.nodes_[i * NodeSize];
+            nodes_.push_back(i == 0 ? parent : node[0] + indexOffset);
+            for (size_t field = 1; field < NodeSize; field += 2) {
+                // keep absent value as is
+                nodes_.push_back(node[field + 1] < 0 ? node[field] : node[field] + poolOffset);
+                nodes_.push_back(node[field + 1]);
+            }
+        }
+        pool_.append(other.pool_);
+    }
+
+    [[nodiscard]] size_t size() const { return nodes_.size() / NodeSize; }
+
+    [[nodiscard]] const std::vector<int32_t> &nodes() const { return nodes_; }
+
+    [[nodiscard]] const std::string &pool() const { return pool_; }
+
+    [[nodiscard]] int32_t parent(size_t index) const { return nodes_[index * NodeSize]; }
+
+    [[nodiscard]] std::string_view name(size_t index) const { return string(index, 1); }
+
+    [[nodiscard]] std::string_view comment(size_t index) const { return string(index, 3); }
+
+    [[nodiscard]] std::string_view value(size_t index) const { return hasValue(index) ? string(index, 5) : std::string_view(); }
+
+    [[nodiscard]] bool hasValue(size_t index) const { return nodes_[index * NodeSize + 6] >= 0; }
+
+private:
+    std::vector<int32_t> nodes_;
+    std::string pool_;
+
+    void appendString(std::string_view s) {
+        nodes_.push_back(static_cast<int32_t>(pool_.size()));
+        nodes_.push_back(static_cast<int32_t>(s.size()));
+        pool_.append(s);
+    }
+
+    [[nodiscard]] std::string_view string(size_t index, size_t field) const {
+        const auto *node = &nodes_[index * NodeSize];
+        return std::string_view(pool_).substr(node[field], node[field + 1]);
+    }
+};
+
+/**
+ * append `config` and its sub items to `flat` under `parent`
+ * @return index of `config` in `flat`
+ */
+inline int32_t appendRawConfig(FlatConfig &flat, const fcitx::RawConfig &config, int32_t parent) {
+    const auto index = flat.add(parent, config.name(), config.comment(), config.value());
+    for (const auto &item: config.subItems()) {
+        appendRawConfig(flat, *config.get(item), index);
+    }
+    return index;
+}
+
+inline FlatConfig flattenRawConfig(const fcitx::RawConfig &config) {
+    FlatConfig flat;
+    appendRawConfig(flat, config, -1);
+    return flat;
+}
+
+/**
+ * Fill `config` from `flat`: nodes with sub items are created under their parent,
+ * and nodes without sub items set their value.
+ */
+inline void fillRawConfig(const FlatConfig &flat, fcitx::RawConfig &config) {
+    std::vector<size_t> childCount(flat.size());
+    for (size_t i = 1; i < flat.size(); i++) {
+        childCount[flat.parent(i)]++;
+    }
+    std::vector<fcitx::RawConfig *> items(flat.size());
+    items[0] = &config;
+    for (size_t i = 0; i < flat.size(); i++) {
+        if (i > 0) {
+            items[i] = items[flat.parent(i)]->get(std::string(flat.name(i)), true).get();
+        }
+        if (childCount[i] == 0 && flat.hasValue(i)) {
+            items[i]->setValue(std::string(flat.value(i)));
+        }
+    }
+}
+
+#endif //FCITX5_ANDROID_FLAT_CONFIG_H
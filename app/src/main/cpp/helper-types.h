@@ -8,6 +8,7 @@
 #include <fcitx/action.h>
 #include <fcitx/menu.h>
 #include <fcitx/inputcontext.h>
+#include <fcitx/addonmanager.h>
 
 class InputMethodStatus {
 public:
@@ -42,6 +43,46 @@ public:
     }
 };
 
+/**
+ * Addon that is looked up on first use rather than at startup.
+ * A failed lookup is not cached, the addon may become available later.
+ */
+class LazyAddon {
+public:
+    std::string name;
+    // load the addon if it has not been loaded yet
+    bool load;
+
+    LazyAddon(std::string name, bool load) :
+            name(std::move(name)),
+            load(load) {}
+
+    fcitx::AddonInstance *get(fcitx::AddonManager &manager) {
+        if (!instance) {
+            instance = manager.addon(name, load);
+        }
+        return instance;
+    }
+
+    void reset() {
+        instance = nullptr;
+    }
+
+private:
+    fcitx::AddonInstance *instance = nullptr;
+};
+
+class ConfigReloadEntry {
+public:
+    // "global", "refresh", or name of addon
+    std::string target;
+    int64_t durationMicros;
+
+    ConfigReloadEntry(std::string target, int64_t durationMicros) :
+            target(std::move(target)),
+            durationMicros(durationMicros) {}
+};
+
 class AddonStatus {
 public:
     const fcitx::AddonInfo *info;
@@ -0,0 +1,142 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef FCITX5_ANDROID_INI_READER_H
+#define FCITX5_ANDROID_INI_READER_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <fcitx-utils/stringutils.h>
+
+#include "flat-config.h"
+
+/**
+ * Parse INI from a buffer in memory, following fcitx::readFromIni:
+ * lines are trimmed, empty lines and lines starting with '#' are skipped, "[A/B]" starts a group at path A/B,
+ * "name=value" sets the value of name under current group, and a name that appears again overwrites the value.
+ *
+ * Names and values that need no unescaping are kept as views into the buffer, until written to FlatConfig.
+ */
+class IniReader {
+public:
+    explicit IniReader(std::string_view data) : data_(data) {}
+
+    FlatConfig read() {
+        nodes_.assign(1, Node{});
+        children_.clear();
+        owned_.clear();
+        uint32_t group = 0;
+        size_t pos = 0;
+        while (pos < data_.size()) {
+            auto end = data_.find('\n', pos);
+            if (end == std::string_view::npos) {
+                end = data_.size();
+            }
+            const auto line = trim(data_.substr(pos, end - pos));
+            pos = end + 1;
+            if (line.empty() || line.front() == '#') {
+                continue;
+            }
+            if (line.front() == '[' && line.back() == ']') {
+                group = path(0, line.substr(1, line.size() - 2));
+                continue;
+            }
+            const auto equal = line.find('=');
+            if (equal == std::string_view::npos) {
+                continue;
+            }
+            std::string_view value = line.substr(equal + 1);
+            if (value.find('\\') != std::string_view::npos || (value.size() >= 2 && value.front() == '"' && value.back() == '"')) {
+                auto unescaped = fcitx::stringutils::unescapeForValue(value);
+                if (!unescaped) {
+                    continue;
+                }
+                value = owned_.emplace_back(std::move(*unescaped));
+            }
+            const auto index = path(group, line.substr(0, equal));
+            nodes_[index].value = value;
+        }
+        FlatConfig config;
+        flatten(config, 0, -1);
+        return config;
+    }
+
+private:
+    struct Node {
+        std::string_view name;
+        std::string_view value;
+        std::vector<uint32_t> children;
+    };
+
+    struct ChildKey {
+        uint32_t parent;
+        std::string_view name;
+
+        bool operator==(const ChildKey &other) const { return parent == other.parent && name == other.name; }
+    };
+
+    struct ChildKeyHash {
+        size_t operator()(const ChildKey &key) const {
+            return std::hash<std::string_view>()(key.name) * 31 + key.parent;
+        }
+    };
+
+    std::string_view data_;
+    std::vector<Node> nodes_;
+    std::unordered_map<ChildKey, uint32_t, ChildKeyHash> children_;
+    std::deque<std::string> owned_;
+
+    static std::string_view trim(std::string_view s) {
+        static constexpr std::string_view spaces(" \t\n\v\f\r");
+        const auto begin = s.find_first_not_of(spaces);
+        if (begin == std::string_view::npos) {
+            return {};
+        }
+        return s.substr(begin, s.find_last_not_of(spaces) - begin + 1);
+    }
+
+    uint32_t child(uint32_t parent, std::string_view name) {
+        const auto [iter, inserted] = children_.try_emplace({parent, name}, static_cast<uint32_t>(nodes_.size()));
+        if (inserted) {
+            nodes_[parent].children.push_back(iter->second);
+            nodes_.push_back({name, {}, {}});
+        }
+        return iter->second;
+    }
+
+    /**
+     * find or create node at `path` under `from`, path segments are separated by '/' and empty ones are skipped
+     */
+    uint32_t path(uint32_t from, std::string_view path) {
+        uint32_t current = from;
+        size_t pos = 0;
+        while (pos <= path.size()) {
+            auto end = path.find('/', pos);
+            if (end == std::string_view::npos) {
+                end = path.size();
+            }
+            if (end > pos) {
+                current = child(current, path.substr(pos, end - pos));
+            }
+            pos = end + 1;
+        }
+        return current;
+    }
+
+    void flatten(FlatConfig &config, uint32_t index, int32_t parent) const {
+        const auto &node = nodes_[index];
+        const auto flatIndex = config.add(parent, node.name, {}, node.value);
+        for (const auto child: node.children) {
+            flatten(config, child, flatIndex);
+        }
+    }
+};
+
+#endif //FCITX5_ANDROID_INI_READER_H
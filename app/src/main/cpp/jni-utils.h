@@ -9,7 +9,7 @@
 
 #include <string>
 
-void throwJavaException(JNIEnv *env, const char *msg) {
+inline void throwJavaException(JNIEnv *env, const char *msg) {
     jclass c = env->FindClass("java/lang/Exception");
     env->ThrowNew(c, msg);
     env->DeleteLocalRef(c);
@@ -114,15 +114,20 @@ public:
     jmethodID InputMethodEntryInitWithSubMode;
 
     jclass RawConfig;
-    jfieldID RawConfigName;
-    jfieldID RawConfigValue;
-    jfieldID RawConfigSubItems;
-    jmethodID RawConfigInit;
-    jmethodID RawConfigSetSubItems;
+    jmethodID RawConfigFromFlat;
 
     jclass AddonInfo;
     jmethodID AddonInfoInit;
 
+    jclass ConfigReloadEntry;
+    jmethodID ConfigReloadEntryInit;
+
+    jclass StartupPhase;
+    jmethodID StartupPhaseInit;
+
+    jclass KeyLatencyHistogram;
+    jmethodID KeyLatencyHistogramInit;
+
     jclass Action;
     jmethodID ActionInit;
 
@@ -137,6 +142,10 @@ public:
     jfieldID PinyinCustomPhraseKey;
     jfieldID PinyinCustomPhraseOrder;
     jfieldID PinyinCustomPhraseValue;
+    jfieldID PinyinCustomPhraseId;
+
+    jclass ProgressListener;
+    jmethodID ProgressListenerOnProgress;
 
     GlobalRefSingleton(JavaVM *jvm_) : jvm(jvm_) {
         JNIEnv *env;
@@ -161,15 +170,20 @@ public:
         InputMethodEntryInitWithSubMode = env->GetMethodID(InputMethodEntry, "<init>", "(Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;ZLjava/lang/String;Ljava/lang/String;Ljava/lang/String;)V");
 
         RawConfig = reinterpret_cast<jclass>(env->NewGlobalRef(env->FindClass("org/fcitx/fcitx5/android/core/RawConfig")));
-        RawConfigName = env->GetFieldID(RawConfig, "name", "Ljava/lang/String;");
-        RawConfigValue = env->GetFieldID(RawConfig, "value", "Ljava/lang/String;");
-        RawConfigSubItems = env->GetFieldID(RawConfig, "subItems", "[Lorg/fcitx/fcitx5/android/core/RawConfig;");
-        RawConfigInit = env->GetMethodID(RawConfig, "<init>", "(Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;[Lorg/fcitx/fcitx5/android/core/RawConfig;)V");
-        RawConfigSetSubItems = env->GetMethodID(RawConfig, "setSubItems", "([Lorg/fcitx/fcitx5/android/core/RawConfig;)V");
+        RawConfigFromFlat = env->GetStaticMethodID(RawConfig, "fromFlat", "([I[B)Lorg/fcitx/fcitx5/android/core/RawConfig;");
 
         AddonInfo = reinterpret_cast<jclass>(env->NewGlobalRef(env->FindClass("org/fcitx/fcitx5/android/core/AddonInfo")));
         AddonInfoInit = env->GetMethodID(AddonInfo, "<init>", "(Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;IZZZZ[Ljava/lang/String;[Ljava/lang/String;)V");
 
+        ConfigReloadEntry = reinterpret_cast<jclass>(env->NewGlobalRef(env->FindClass("org/fcitx/fcitx5/android/core/ConfigReloadEntry")));
+        ConfigReloadEntryInit = env->GetMethodID(ConfigReloadEntry, "<init>", "(Ljava/lang/String;J)V");
+
+        StartupPhase = reinterpret_cast<jclass>(env->NewGlobalRef(env->FindClass("org/fcitx/fcitx5/android/core/StartupPhase")));
+        StartupPhaseInit = env->GetMethodID(StartupPhase, "<init>", "(Ljava/lang/String;IJJZ)V");
+
+        KeyLatencyHistogram = reinterpret_cast<jclass>(env->NewGlobalRef(env->FindClass("org/fcitx/fcitx5/android/core/KeyLatencyHistogram")));
+        KeyLatencyHistogramInit = env->GetMethodID(KeyLatencyHistogram, "<init>", "(Ljava/lang/String;Ljava/lang/String;JJJ[J[J)V");
+
         Action = reinterpret_cast<jclass>(env->NewGlobalRef(env->FindClass("org/fcitx/fcitx5/android/core/Action")));
         ActionInit = env->GetMethodID(Action, "<init>", "(IZZZLjava/lang/String;Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;[Lorg/fcitx/fcitx5/android/core/Action;)V");
 
@@ -180,10 +194,14 @@ public:
         FormattedTextFromByteCursor = env->GetStaticMethodID(FormattedText, "fromByteCursor", "([Ljava/lang/String;[II)Lorg/fcitx/fcitx5/android/core/FormattedText;");
 
         PinyinCustomPhrase = reinterpret_cast<jclass>(env->NewGlobalRef(env->FindClass("org/fcitx/fcitx5/android/data/pinyin/customphrase/PinyinCustomPhrase")));
-        PinyinCustomPhraseInit = env->GetMethodID(PinyinCustomPhrase, "<init>", "(Ljava/lang/String;ILjava/lang/String;)V");
+        PinyinCustomPhraseInit = env->GetMethodID(PinyinCustomPhrase, "<init>", "(Ljava/lang/String;ILjava/lang/String;I)V");
         PinyinCustomPhraseKey = env->GetFieldID(PinyinCustomPhrase, "key", "Ljava/lang/String;");
         PinyinCustomPhraseOrder = env->GetFieldID(PinyinCustomPhrase, "order", "I");
         PinyinCustomPhraseValue = env->GetFieldID(PinyinCustomPhrase, "value", "Ljava/lang/String;");
+        PinyinCustomPhraseId = env->GetFieldID(PinyinCustomPhrase, "id", "I");
+
+        ProgressListener = reinterpret_cast<jclass>(env->NewGlobalRef(env->FindClass("org/fcitx/fcitx5/android/core/ProgressListener")));
+        ProgressListenerOnProgress = env->GetMethodID(ProgressListener, "onProgress", "(JJ)Z");
     }
 
     const JEnv AttachEnv() const { return JEnv(jvm); }
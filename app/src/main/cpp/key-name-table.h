@@ -0,0 +1,164 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef FCITX5_ANDROID_KEY_NAME_TABLE_H
+#define FCITX5_ANDROID_KEY_NAME_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Perfect hash table of key names that keyboard layouts may send to fcitx, built at compile time.
+ *
+ * Single characters never reach the table, they are converted from UTF-16 directly. Names not in
+ * the table fall back to fcitx::Key::keySymFromString, so the table only needs to cover the common ones.
+ * Values are X11 keysyms, the same as FcitxKey_* in fcitx-utils/keysymgen.h.
+ */
+namespace key_name_table {
+
+struct Entry {
+    std::string_view name;
+    uint32_t sym;
+};
+
+constexpr Entry Entries[] = {
+        {"space", 0x0020}, {"exclam", 0x0021}, {"quotedbl", 0x0022}, {"numbersign", 0x0023},
+        {"dollar", 0x0024}, {"percent", 0x0025}, {"ampersand", 0x0026}, {"apostrophe", 0x0027},
+        {"parenleft", 0x0028}, {"parenright", 0x0029}, {"asterisk", 0x002a}, {"plus", 0x002b},
+        {"comma", 0x002c}, {"minus", 0x002d}, {"period", 0x002e}, {"slash", 0x002f},
+        {"colon", 0x003a}, {"semicolon", 0x003b}, {"less", 0x003c}, {"equal", 0x003d},
+        {"greater", 0x003e}, {"question", 0x003f}, {"at", 0x0040}, {"bracketleft", 0x005b},
+        {"backslash", 0x005c}, {"bracketright", 0x005d}, {"asciicircum", 0x005e}, {"underscore", 0x005f},
+        {"grave", 0x0060}, {"braceleft", 0x007b}, {"bar", 0x007c}, {"braceright", 0x007d},
+        {"asciitilde", 0x007e},
+        {"BackSpace", 0xff08}, {"Tab", 0xff09}, {"Linefeed", 0xff0a}, {"Clear", 0xff0b},
+        {"Return", 0xff0d}, {"Pause", 0xff13}, {"Scroll_Lock", 0xff14}, {"Escape", 0xff1b},
+        {"Home", 0xff50}, {"Left", 0xff51}, {"Up", 0xff52}, {"Right", 0xff53},
+        {"Down", 0xff54}, {"Prior", 0xff55}, {"Page_Up", 0xff55}, {"Next", 0xff56},
+        {"Page_Down", 0xff56}, {"End", 0xff57}, {"Begin", 0xff58}, {"Insert", 0xff63},
+        {"Menu", 0xff67}, {"Num_Lock", 0xff7f}, {"KP_Enter", 0xff8d}, {"KP_Multiply", 0xffaa},
+        {"KP_Add", 0xffab}, {"KP_Separator", 0xffac}, {"KP_Subtract", 0xffad}, {"KP_Decimal", 0xffae},
+        {"KP_Divide", 0xffaf}, {"KP_0", 0xffb0}, {"KP_1", 0xffb1}, {"KP_2", 0xffb2},
+        {"KP_3", 0xffb3}, {"KP_4", 0xffb4}, {"KP_5", 0xffb5}, {"KP_6", 0xffb6},
+        {"KP_7", 0xffb7}, {"KP_8", 0xffb8}, {"KP_9", 0xffb9}, {"KP_Equal", 0xffbd},
+        {"F1", 0xffbe}, {"F2", 0xffbf}, {"F3", 0xffc0}, {"F4", 0xffc1},
+        {"F5", 0xffc2}, {"F6", 0xffc3}, {"F7", 0xffc4}, {"F8", 0xffc5},
+        {"F9", 0xffc6}, {"F10", 0xffc7}, {"F11", 0xffc8}, {"F12", 0xffc9},
+        {"Shift_L", 0xffe1}, {"Shift_R", 0xffe2}, {"Control_L", 0xffe3}, {"Control_R", 0xffe4},
+        {"Caps_Lock", 0xffe5}, {"Meta_L", 0xffe7}, {"Meta_R", 0xffe8}, {"Alt_L", 0xffe9},
+        {"Alt_R", 0xffea}, {"Super_L", 0xffeb}, {"Super_R", 0xffec}, {"Delete", 0xffff},
+};
+
+constexpr size_t EntryCount = sizeof(Entries) / sizeof(Entries[0]);
+
+// power of two, large enough that a collision free seed is found within a few tries
+constexpr size_t SlotCount = 2048;
+
+constexpr size_t MaxNameLength = 16;
+
+constexpr uint32_t hash(std::string_view s, uint32_t seed) {
+    uint32_t h = 0x811c9dc5 ^ seed;
+    for (const char c: s) {
+        h = (h ^ static_cast<uint8_t>(c)) * 0x01000193;
+    }
+    return h;
+}
+
+constexpr bool collisionFree(uint32_t seed) {
+    bool used[SlotCount] = {};
+    for (const auto &e: Entries) {
+        const auto slot = hash(e.name, seed) & (SlotCount - 1);
+        if (used[slot]) {
+            return false;
+        }
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t findSeed() {
+    uint32_t seed = 0;
+    while (!collisionFree(seed)) {
+        seed++;
+    }
+    return seed;
+}
+
+constexpr uint32_t Seed = findSeed();
+
+struct Slots {
+    // index into Entries, -1 for empty slot
+    int16_t index[SlotCount];
+};
+
+constexpr Slots buildSlots() {
+    Slots slots{};
+    for (auto &i: slots.index) {
+        i = -1;
+    }
+    for (size_t i = 0; i < EntryCount; i++) {
+        slots.index[hash(Entries[i].name, Seed) & (SlotCount - 1)] = static_cast<int16_t>(i);
+    }
+    return slots;
+}
+
+constexpr Slots Table = buildSlots();
+
+constexpr bool namesFit() {
+    for (const auto &e: Entries) {
+        if (e.name.size() > MaxNameLength) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace key_name_table
+
+/**
+ * @return keysym of `name`, or 0 (FcitxKey_None) if it is not in the table
+ */
+constexpr uint32_t lookupKeyName(std::string_view name) {
+    using namespace key_name_table;
+    const auto i = Table.index[hash(name, Seed) & (SlotCount - 1)];
+    return i >= 0 && Entries[i].name == name ? Entries[i].sym : 0;
+}
+
+static_assert(key_name_table::namesFit(), "key name longer than MaxNameLength");
+static_assert(lookupKeyName("BackSpace") == 0xff08 && lookupKeyName("Page_Down") == 0xff56 &&
+              lookupKeyName("backspace") == 0, "key name table is broken");
+
+/**
+ * @return the only code point in `s`, or 0 if `s` is not exactly one character, or contains a lone surrogate
+ */
+inline uint32_t singleCodePoint(const char16_t *s, size_t length) {
+    if (length == 1) {
+        return (s[0] >= 0xd800 && s[0] <= 0xdfff) ? 0 : s[0];
+    }
+    if (length == 2 && s[0] >= 0xd800 && s[0] <= 0xdbff && s[1] >= 0xdc00 && s[1] <= 0xdfff) {
+        return 0x10000 + ((static_cast<uint32_t>(s[0]) - 0xd800) << 10) + (s[1] - 0xdc00);
+    }
+    return 0;
+}
+
+/**
+ * Look up a key name given in UTF-16, without allocating
+ * @return keysym, or 0 if `s` is not an ASCII name in the table
+ */
+inline uint32_t lookupKeyName(const char16_t *s, size_t length) {
+    if (length > key_name_table::MaxNameLength) {
+        return 0;
+    }
+    char name[key_name_table::MaxNameLength];
+    for (size_t i = 0; i < length; i++) {
+        if (s[i] >= 0x80) {
+            return 0;
+        }
+        name[i] = static_cast<char>(s[i]);
+    }
+    return lookupKeyName(std::string_view(name, length));
+}
+
+#endif //FCITX5_ANDROID_KEY_NAME_TABLE_H
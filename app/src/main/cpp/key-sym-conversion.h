@@ -0,0 +1,35 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef FCITX5_ANDROID_KEY_SYM_CONVERSION_H
+#define FCITX5_ANDROID_KEY_SYM_CONVERSION_H
+
+#include <fcitx-utils/key.h>
+
+#include "jni-utils.h"
+#include "key-name-table.h"
+
+static_assert(sizeof(jchar) == sizeof(char16_t));
+
+/**
+ * single characters and common key names are resolved on the stack,
+ * only other names go through fcitx::Key::keySymFromString, which needs a std::string
+ */
+inline fcitx::KeySym keySymFromJString(JNIEnv *env, jstring key) {
+    const jsize length = env->GetStringLength(key);
+    if (length > 0 && length <= static_cast<jsize>(key_name_table::MaxNameLength)) {
+        jchar buf[key_name_table::MaxNameLength];
+        env->GetStringRegion(key, 0, length, buf);
+        const auto *s = reinterpret_cast<const char16_t *>(buf);
+        if (const auto c = singleCodePoint(s, length)) {
+            return fcitx::Key::keySymFromUnicode(c);
+        }
+        if (const auto sym = lookupKeyName(s, length)) {
+            return static_cast<fcitx::KeySym>(sym);
+        }
+    }
+    return fcitx::Key::keySymFromString(CString(env, key));
+}
+
+#endif //FCITX5_ANDROID_KEY_SYM_CONVERSION_H
@@ -0,0 +1,198 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef FCITX5_ANDROID_LATENCY_HISTOGRAM_H
+#define FCITX5_ANDROID_LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Log-linear histogram of microseconds, in the manner of HdrHistogram: values below 2^SubBucketBits
+ * are exact, every larger power of two is split into 2^SubBucketBits buckets, which bounds the
+ * relative error to 1/2^SubBucketBits. Values larger than 2^MaxBits - 1 are clamped.
+ *
+ * record() is wait-free and may run concurrently with snapshot() and reset() on other threads.
+ * A snapshot taken while recording may be off by the events recorded meanwhile, but never torn.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int SubBucketBits = 4;
+    static constexpr int MaxBits = 32;
+    static constexpr size_t SubBucketCount = size_t(1) << SubBucketBits;
+    static constexpr size_t BucketCount = (MaxBits - SubBucketBits + 1) * SubBucketCount;
+    static constexpr uint64_t MaxValue = (uint64_t(1) << MaxBits) - 1;
+
+    struct Bucket {
+        // inclusive
+        uint64_t upperBound;
+        uint64_t count;
+    };
+
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+        // only non-empty buckets, in ascending order
+        std::vector<Bucket> buckets;
+    };
+
+    static size_t bucketIndex(uint64_t value) {
+        if (value > MaxValue) {
+            value = MaxValue;
+        }
+        if (value < SubBucketCount) {
+            return static_cast<size_t>(value);
+        }
+        const int msb = 63 - __builtin_clzll(value);
+        const int shift = msb - SubBucketBits;
+        return (static_cast<size_t>(shift + 1) << SubBucketBits) +
+               static_cast<size_t>((value >> shift) & (SubBucketCount - 1));
+    }
+
+    static uint64_t bucketUpperBound(size_t index) {
+        if (index < SubBucketCount) {
+            return index;
+        }
+        const int shift = static_cast<int>(index >> SubBucketBits) - 1;
+        const uint64_t lower = (SubBucketCount + (index & (SubBucketCount - 1))) << shift;
+        return lower + (uint64_t(1) << shift) - 1;
+    }
+
+    void record(uint64_t value) {
+        counts_[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+        uint64_t max = max_.load(std::memory_order_relaxed);
+        while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    Snapshot snapshot() const {
+        Snapshot s;
+        s.count = count_.load(std::memory_order_relaxed);
+        s.sum = sum_.load(std::memory_order_relaxed);
+        s.max = max_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < BucketCount; i++) {
+            const auto count = counts_[i].load(std::memory_order_relaxed);
+            if (count) {
+                s.buckets.push_back({bucketUpperBound(i), count});
+            }
+        }
+        return s;
+    }
+
+    void reset() {
+        for (auto &c: counts_) {
+            c.store(0, std::memory_order_relaxed);
+        }
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, BucketCount> counts_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+/**
+ * Key press latency of each input method, split into stages:
+ *   Dispatch: Android event time -> JNI entry, only for keys that carry an event time
+ *   Engine:   JNI entry -> key event returned from input method
+ *   Output:   JNI entry -> first commit, preedit or input panel update caused by the key
+ *
+ * Input methods are only added on the thread that records, other threads can read and reset at any time.
+ */
+class KeyLatencyStats {
+public:
+    enum Stage {
+        Dispatch = 0,
+        Engine,
+        Output,
+        StageCount
+    };
+
+    static constexpr const char *StageNames[StageCount] = {"dispatch", "engine", "output"};
+
+    // no more histograms for input methods beyond this, which is unlikely to happen in practice
+    static constexpr size_t MaxInputMethods = 16;
+
+    struct Entry {
+        std::string inputMethod;
+        std::array<LatencyHistogram, StageCount> stages;
+    };
+
+    KeyLatencyStats() = default;
+
+    KeyLatencyStats(const KeyLatencyStats &) = delete;
+
+    ~KeyLatencyStats() {
+        for (auto &e: entries_) {
+            delete e.load(std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * microseconds of steady_clock, which is CLOCK_MONOTONIC like SystemClock.uptimeMillis
+     */
+    static int64_t now() {
+        const auto t = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::microseconds>(t).count();
+    }
+
+    /**
+     * find or add histograms of `inputMethod`, must be called on the recording thread
+     * @return nullptr if there are too many input methods
+     */
+    Entry *entry(const std::string &inputMethod) {
+        for (auto &e: entries_) {
+            auto *entry = e.load(std::memory_order_acquire);
+            if (!entry) {
+                entry = new Entry{inputMethod, {}};
+                e.store(entry, std::memory_order_release);
+                return entry;
+            }
+            if (entry->inputMethod == inputMethod) {
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+
+    template <typename F>
+    void forEach(F &&callback) const {
+        for (const auto &e: entries_) {
+            const auto *entry = e.load(std::memory_order_acquire);
+            if (!entry) {
+                break;
+            }
+            callback(*entry);
+        }
+    }
+
+    void reset() {
+        for (auto &e: entries_) {
+            auto *entry = e.load(std::memory_order_acquire);
+            if (!entry) {
+                break;
+            }
+            for (auto &h: entry->stages) {
+                h.reset();
+            }
+        }
+    }
+
+private:
+    std::array<std::atomic<Entry *>, MaxInputMethods> entries_{};
+};
+
+#endif //FCITX5_ANDROID_LATENCY_HISTOGRAM_H
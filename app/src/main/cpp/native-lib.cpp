@@ -6,9 +6,13 @@
 
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <memory>
+#include <mutex>
 #include <future>
 #include <fstream>
+#include <chrono>
+#include <sstream>
 
 #include <android/log.h>
 
@@ -25,6 +29,7 @@
 #include <fcitx-utils/i18n.h>
 #include <fcitx-utils/event.h>
 #include <fcitx-utils/eventdispatcher.h>
+#include <fcitx-utils/fs.h>
 #include <fcitx-utils/standardpath.h>
 #include <fcitx-utils/stringutils.h>
 #include <fcitx-config/iniparser.h>
@@ -37,6 +42,7 @@
 #include <libime/table/tablebaseddictionary.h>
 
 #include <boost/iostreams/device/file_descriptor.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/iostreams/stream_buffer.hpp>
 #include "customphrase.h"
 
@@ -46,6 +52,17 @@
 #include "nativestreambuf.h"
 #include "helper-types.h"
 #include "object-conversion.h"
+#include "scel-dict.h"
+#include "pinyin-dict-batch.h"
+#include "table-dict-check.h"
+#include "dict-diff.h"
+#include "customphrase-store.h"
+#include "ini-reader.h"
+#include "config-desc-cache.h"
+#include "config-reload.h"
+#include "startup-profile.h"
+#include "key-sym-conversion.h"
+#include "latency-histogram.h"
 
 
 class Fcitx {
@@ -78,25 +95,122 @@ public:
     }
 
     int loopOnce() {
-        return uv_run(get_event_base(), UV_RUN_ONCE);
+        const int result = uv_run(get_event_base(), UV_RUN_ONCE);
+        // input panel of the last key has been flushed in this iteration, later output is not caused by it
+        pendingKeyMicros = -1;
+        return result;
     }
 
+    /**
+     * locale passed to startupFcitx, which translations of config descriptions follow
+     */
+    void setLocale(const std::string &newLocale) {
+        if (locale != newLocale) {
+            locale = newLocale;
+            configDescCache.clear();
+        }
+    }
+
+    /**
+     * @param deferAddons whether to load clipboard and the engine of current input method one by
+     *                    one after setupCallback, when fcitx is idle. Instance::initialize still
+     *                    loads every addon that is not OnDemand before setupCallback, fcitx cannot
+     *                    load those later, so this saves little of the time until ready
+     */
     void startup(fcitx::AndroidLibraryDependency dependency,
+                 bool deferAddons,
                  const std::function<void(fcitx::AddonInstance *)> &setupCallback) {
+        startupProfile.begin("instance");
         p_instance = std::make_unique<fcitx::Instance>(0, nullptr);
-        p_instance->addonManager().registerLoader(std::make_unique<fcitx::AndroidSharedLibraryLoader>(dependency));
+        auto loader = std::make_unique<fcitx::AndroidSharedLibraryLoader>(std::move(dependency));
+        auto *loaderPtr = loader.get();
+        p_loader = loaderPtr;
+        startupProfile.end();
+        p_instance->addonManager().registerLoader(std::move(loader));
         p_dispatcher = std::make_unique<fcitx::EventDispatcher>();
         p_dispatcher->attach(&p_instance->eventLoop());
+        startupProfile.begin("initialize");
         p_instance->initialize();
         auto &addonMgr = p_instance->addonManager();
         p_frontend = addonMgr.addon("androidfrontend");
-        p_quickphrase = addonMgr.addon("quickphrase");
-        p_unicode = addonMgr.addon("unicode");
-        p_clipboard = addonMgr.addon("clipboard", true);
-        setupCallback(p_frontend);
+        if (!deferAddons) {
+            for (auto *addon: {&quickphraseAddon, &unicodeAddon, &clipboardAddon}) {
+                addon->get(addonMgr);
+            }
+        }
+        // both happen on this thread, an addon may be loaded while creating another
+        auto timings = libraryLoadTimings(*loaderPtr);
+        for (const auto &t: loaderPtr->createTimings()) {
+            timings.push_back({"create " + t.name, t.startMicros, t.durationMicros});
+        }
+        startupProfile.add(std::move(timings), true);
+        startupProfile.end();
+        {
+            StartupProfile::Scope scope(startupProfile, "callbacks");
+            setupCallback(p_frontend);
+        }
+        takeConfigSnapshot();
+        if (deferAddons) {
+            scheduleDeferredAddons();
+        }
+    }
+
+    StartupProfile &profile() {
+        return startupProfile;
+    }
+
+    /**
+     * Load addons of newly installed plugins, and addons that have been enabled, while keeping
+     * Instance, event loop, and other addons alive.
+     * @param dataChanged whether data files of app or plugins have been changed since startup,
+     *                    which addons already loaded only pick up on reloadConfig
+     * @return time spent in microseconds, or -1 if a cold restart is needed, because fcitx can
+     *         neither unload a single addon nor load an addon that was disabled when first seen
+     */
+    int64_t softRestart(fcitx::AndroidLibraryDependency dependency, bool dataChanged) {
+        const auto start = StartupProfile::now();
+        auto &addonManager = p_instance->addonManager();
+        // everything that can be checked before the loader and addon manager are touched
+        for (const auto &status: getAddons()) {
+            const auto &name = status.info->uniqueName();
+            if (!status.enabled && addonManager.lookupAddon(name)) {
+                FCITX_INFO() << "Cannot unload addon " << name << " without a cold restart";
+                return -1;
+            }
+        }
+        if (!p_loader->update(std::move(dependency))) {
+            FCITX_INFO() << "Plugin libraries have been removed or changed, need a cold restart";
+            return -1;
+        }
+        auto &globalConfig = p_instance->globalConfig();
+        const auto &enabledAddons = globalConfig.enabledAddons();
+        const auto &disabledAddons = globalConfig.disabledAddons();
+        // only reads .conf files of addons it has not seen yet
+        addonManager.load({enabledAddons.begin(), enabledAddons.end()},
+                          {disabledAddons.begin(), disabledAddons.end()});
+        for (const auto &status: getAddons()) {
+            const auto &name = status.info->uniqueName();
+            if (status.enabled && !status.info->onDemand() && !addonManager.lookupAddon(name)) {
+                if (!addonManager.addon(name, true)) {
+                    FCITX_INFO() << "Cannot load addon " << name << " without a cold restart";
+                    return -1;
+                }
+            }
+        }
+        if (dataChanged) {
+            reloadConfig();
+        } else {
+            configDescCache.clear();
+            p_instance->refresh();
+        }
+        takeConfigSnapshot();
+        const auto duration = StartupProfile::now() - start;
+        FCITX_INFO() << "Soft restart finished in " << duration << "us";
+        return duration;
     }
 
     void reloadConfig() {
+        configDescCache.clear();
         p_instance->reloadConfig();
         p_instance->refresh();
         auto &addonManager = p_instance->addonManager();
@@ -110,10 +224,97 @@ public:
                 p_instance->reloadAddonConfig(name);
             }
         }
+        takeConfigSnapshot();
+    }
+
+    /**
+     * reload only what is affected by files changed in user config and data directories since last reload
+     * @return what has been reloaded, in order, and how long it took
+     */
+    std::vector<ConfigReloadEntry> reloadChangedConfig() {
+        auto config = snapshotConfigFiles();
+        auto data = snapshotDataFiles();
+        const auto plan = planConfigReload(configSnapshot.changedIn(config), dataSnapshot.changedIn(data),
+                                           [this](const std::string &name) { return isAddon(name); });
+        configSnapshot = std::move(config);
+        dataSnapshot = std::move(data);
+        std::vector<ConfigReloadEntry> report;
+        const auto timed = [&](const std::string &target, const std::function<void()> &action) {
+            const auto start = std::chrono::steady_clock::now();
+            action();
+            const auto duration = std::chrono::steady_clock::now() - start;
+            report.emplace_back(target, std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+        };
+        if (plan.global) {
+            timed("global", [&] { p_instance->reloadConfig(); });
+        }
+        if (plan.refresh) {
+            timed("refresh", [&] { p_instance->refresh(); });
+        }
+        if (!plan.addons.empty()) {
+            configDescCache.clear();
+        }
+        for (const auto &name: orderByDependency(plan.addons)) {
+            timed(name, [&] { p_instance->reloadAddonConfig(name); });
+        }
+        return report;
     }
 
-    void sendKey(fcitx::Key key, bool up, int timestamp) {
+    /**
+     * @param eventTime uptime in milliseconds when Android received the key, or -1 if unknown
+     */
+    void sendKey(fcitx::Key key, bool up, int timestamp, int64_t eventTime = -1) {
+        if (up) {
+            p_frontend->call<fcitx::IAndroidFrontend::keyEvent>(key, up, timestamp);
+            return;
+        }
+        const auto entry = KeyLatencyStats::now();
+        if (!currentKeyLatency) {
+            currentKeyLatency = keyLatency.entry(p_instance->currentInputMethod());
+        }
+        auto *latency = currentKeyLatency;
+        if (latency) {
+            // output may be emitted before keyEvent returns
+            pendingKeyLatency = latency;
+            pendingKeyMicros = entry;
+        }
         p_frontend->call<fcitx::IAndroidFrontend::keyEvent>(key, up, timestamp);
+        if (!latency) {
+            return;
+        }
+        if (eventTime >= 0) {
+            latency->stages[KeyLatencyStats::Dispatch].record(std::max<int64_t>(entry - eventTime * 1000, 0));
+        }
+        latency->stages[KeyLatencyStats::Engine].record(KeyLatencyStats::now() - entry);
+    }
+
+    /**
+     * called on commit, preedit and input panel updates, to measure output latency of the last key
+     */
+    void keyOutput() {
+        if (pendingKeyMicros < 0) {
+            return;
+        }
+        pendingKeyLatency->stages[KeyLatencyStats::Output].record(KeyLatencyStats::now() - pendingKeyMicros);
+        pendingKeyMicros = -1;
+    }
+
+    void inputMethodChanged() {
+        currentKeyLatency = nullptr;
+    }
+
+    /**
+     * can be read and reset on any thread, and is kept after exit
+     */
+    KeyLatencyStats &keyLatencyStats() {
+        return keyLatency;
+    }
+
+    /**
+     * emit pending UI updates now, rather than at the end of next event loop iteration
+     */
+    void flushUI() {
+        p_instance->flushUI();
     }
 
     bool select(int idx) {
@@ -192,18 +393,20 @@ public:
         imMgr.save();
     }
 
-    static fcitx::RawConfig mergeConfigDesc(const fcitx::Configuration &conf) {
-        fcitx::RawConfig topLevel;
-        auto cfg = topLevel.get("cfg", true);
-        conf.save(*cfg);
-        auto desc = topLevel.get("desc", true);
-        conf.dumpDescription(*desc);
-        return topLevel;
+    std::unique_ptr<FlatConfig> mergeConfigDesc(const fcitx::Configuration &conf,
+                                                const std::string &addon,
+                                                const std::string &path) {
+        std::string version;
+        if (const auto *info = p_instance->addonManager().addonInfo(addon)) {
+            version = info->version().toString();
+        }
+        const auto &desc = configDescCache.get({addon, path, locale, version}, conf);
+        return std::make_unique<FlatConfig>(mergeFlatConfigDesc(conf, desc));
     }
 
-    std::unique_ptr<fcitx::RawConfig> getGlobalConfig() {
+    std::unique_ptr<FlatConfig> getGlobalConfig() {
         const auto &configuration = p_instance->globalConfig().config();
-        return std::make_unique<fcitx::RawConfig>(mergeConfigDesc(configuration));
+        return mergeConfigDesc(configuration, "", "global");
     }
 
     void setGlobalConfig(const fcitx::RawConfig &config) {
@@ -221,7 +424,7 @@ public:
         return p_instance->addonManager().addon(addon, true);
     }
 
-    std::unique_ptr<fcitx::RawConfig> getAddonConfig(const std::string &addonName) {
+    std::unique_ptr<FlatConfig> getAddonConfig(const std::string &addonName) {
         const auto addonInstance = getAddonInstance(addonName);
         if (!addonInstance) {
             return nullptr;
@@ -230,7 +433,7 @@ public:
         if (!configuration) {
             return nullptr;
         }
-        return std::make_unique<fcitx::RawConfig>(mergeConfigDesc(*configuration));
+        return mergeConfigDesc(*configuration, addonName, "");
     }
 
     void setAddonConfig(const std::string &addonName, const fcitx::RawConfig &config) {
@@ -241,7 +444,7 @@ public:
         addonInstance->setConfig(config);
     }
 
-    std::unique_ptr<fcitx::RawConfig> getAddonSubConfig(const std::string &addonName, const std::string &path) {
+    std::unique_ptr<FlatConfig> getAddonSubConfig(const std::string &addonName, const std::string &path) {
         const auto addonInstance = getAddonInstance(addonName);
         if (!addonInstance) {
             return nullptr;
@@ -250,7 +453,7 @@ public:
         if (!configuration) {
             return nullptr;
         }
-        return std::make_unique<fcitx::RawConfig>(mergeConfigDesc(*configuration));
+        return mergeConfigDesc(*configuration, addonName, path);
     }
 
     void setAddonSubConfig(const std::string &addonName, const std::string &path, const fcitx::RawConfig &config) {
@@ -261,7 +464,7 @@ public:
         addonInstance->setSubConfig(path, config);
     }
 
-    std::unique_ptr<fcitx::RawConfig> getInputMethodConfig(const std::string &imName) {
+    std::unique_ptr<FlatConfig> getInputMethodConfig(const std::string &imName) {
         const auto *entry = p_instance->inputMethodManager().entry(imName);
         if (!entry || !entry->isConfigurable()) {
             return nullptr;
@@ -274,7 +477,7 @@ public:
         if (!configuration) {
             return nullptr;
         }
-        return std::make_unique<fcitx::RawConfig>(mergeConfigDesc(*configuration));
+        return mergeConfigDesc(*configuration, entry->addon(), "inputmethod/" + imName);
     }
 
     void setInputMethodConfig(const std::string &imName, const fcitx::RawConfig &config) {
@@ -349,28 +552,32 @@ public:
         globalConfig.setEnabledAddons({enabledSet.begin(), enabledSet.end()});
         globalConfig.setDisabledAddons({disabledSet.begin(), disabledSet.end()});
         globalConfig.safeSave();
+        configDescCache.clear();
         p_instance->reloadConfig();
     }
 
     void triggerQuickPhrase() {
-        if (!p_quickphrase) return;
+        auto *quickphrase = quickphraseAddon.get(p_instance->addonManager());
+        if (!quickphrase) return;
         auto *ic = p_frontend->call<fcitx::IAndroidFrontend::activeInputContext>();
         if (!ic) return;
-        p_quickphrase->call<fcitx::IQuickPhrase::trigger>(
+        quickphrase->call<fcitx::IQuickPhrase::trigger>(
                 ic, "", "", "", "", fcitx::Key{FcitxKey_None}
         );
     }
 
     void triggerUnicode() {
-        if (!p_unicode) return;
+        auto *unicode = unicodeAddon.get(p_instance->addonManager());
+        if (!unicode) return;
         auto *ic = p_frontend->call<fcitx::IAndroidFrontend::activeInputContext>();
         if (!ic) return;
-        p_unicode->call<fcitx::IUnicode::trigger>(ic);
+        unicode->call<fcitx::IUnicode::trigger>(ic);
     }
 
     void setClipboard(const std::string &string, bool password) {
-        if (!p_clipboard) return;
-        p_clipboard->call<fcitx::IClipboard::setClipboardV2>("", string, password);
+        auto *clipboard = clipboardAddon.get(p_instance->addonManager());
+        if (!clipboard) return;
+        clipboard->call<fcitx::IClipboard::setClipboardV2>("", string, password);
     }
 
     void focusInputContext(bool focus) {
@@ -393,6 +600,11 @@ public:
         p_frontend->call<fcitx::IAndroidFrontend::setCapabilityFlags>(flags);
     }
 
+    void setSurroundingText(const std::string &text, int cursor, int anchor) {
+        if (!p_frontend) return;
+        p_frontend->call<fcitx::IAndroidFrontend::setSurroundingText>(text, cursor, anchor);
+    }
+
     std::vector<ActionEntity> statusAreaActions() {
         auto actions = std::vector<ActionEntity>();
         auto *ic = p_frontend->call<fcitx::IAndroidFrontend::activeInputContext>();
@@ -444,17 +656,123 @@ private:
     std::unique_ptr<fcitx::Instance> p_instance;
     std::unique_ptr<fcitx::EventDispatcher> p_dispatcher;
     fcitx::AddonInstance *p_frontend = nullptr;
-    fcitx::AddonInstance *p_quickphrase = nullptr;
-    fcitx::AddonInstance *p_unicode = nullptr;
-    fcitx::AddonInstance *p_clipboard = nullptr;
+    // owned by addon manager of p_instance
+    fcitx::AndroidSharedLibraryLoader *p_loader = nullptr;
+    LazyAddon quickphraseAddon{"quickphrase", false};
+    LazyAddon unicodeAddon{"unicode", false};
+    LazyAddon clipboardAddon{"clipboard", true};
+    // addons to load when idle, in order
+    std::vector<std::string> deferredAddons;
+    KeyLatencyStats keyLatency;
+    // histograms of current input method, resolved on next key press after input method changes
+    KeyLatencyStats::Entry *currentKeyLatency = nullptr;
+    // last key press that has not produced any output yet
+    KeyLatencyStats::Entry *pendingKeyLatency = nullptr;
+    int64_t pendingKeyMicros = -1;
+    std::string locale;
+    ConfigDescCache configDescCache;
+    // kept after exit, until next startup
+    StartupProfile startupProfile;
+    ConfigFileSnapshot configSnapshot;
+    ConfigFileSnapshot dataSnapshot;
+
+    bool isAddon(const std::string &name) const {
+        return p_instance->addonManager().addonInfo(name) != nullptr;
+    }
+
+    static ConfigFileSnapshot snapshotConfigFiles() {
+        const auto &sp = fcitx::StandardPath::global();
+        return {sp.userDirectory(fcitx::StandardPath::Type::PkgConfig), isReloadableConfig};
+    }
+
+    /**
+     * only directories of addons, since the data directory also holds lua scripts, themes and such
+     */
+    ConfigFileSnapshot snapshotDataFiles() const {
+        const auto &sp = fcitx::StandardPath::global();
+        return {sp.userDirectory(fcitx::StandardPath::Type::PkgData), [this](const std::string &name) {
+            return isReloadableData(name, [this](const std::string &addon) { return isAddon(addon); });
+        }};
+    }
+
+    void takeConfigSnapshot() {
+        configSnapshot = snapshotConfigFiles();
+        dataSnapshot = snapshotDataFiles();
+    }
+
+    void scheduleDeferredAddons() {
+        deferredAddons.clear();
+        // engine of current input method would otherwise be loaded on first focus
+        const auto &imName = p_instance->inputMethodManager().currentGroup().defaultInputMethod();
+        if (const auto *entry = p_instance->inputMethodManager().entry(imName)) {
+            deferredAddons.push_back(entry->addon());
+        }
+        if (clipboardAddon.load) {
+            deferredAddons.push_back(clipboardAddon.name);
+        }
+        loadNextDeferredAddon();
+    }
+
+    void loadNextDeferredAddon() {
+        if (deferredAddons.empty()) return;
+        // one addon per loop iteration, key events in between are not blocked for long
+        p_dispatcher->schedule([this]() {
+            if (!p_instance || deferredAddons.empty()) return;
+            const auto name = deferredAddons.front();
+            deferredAddons.erase(deferredAddons.begin());
+            auto &addonManager = p_instance->addonManager();
+            if (!addonManager.lookupAddon(name)) {
+                const auto start = StartupProfile::now();
+                addonManager.addon(name, true);
+                FCITX_INFO() << "Loaded deferred addon " << name << " in " << StartupProfile::now() - start << "us";
+            }
+            loadNextDeferredAddon();
+        });
+    }
+
+    static std::vector<StartupProfile::Timing> libraryLoadTimings(const fcitx::AndroidSharedLibraryLoader &loader) {
+        std::vector<StartupProfile::Timing> timings;
+        for (const auto &t: loader.loadTimings()) {
+            timings.push_back({"dlopen " + t.name + (t.loaded ? "" : " (failed)"), t.startMicros, t.durationMicros});
+        }
+        return timings;
+    }
+
+    /**
+     * sort `names` so that an addon comes after those it depends on
+     */
+    std::vector<std::string> orderByDependency(const std::set<std::string> &names) {
+        auto &addonManager = p_instance->addonManager();
+        std::vector<std::string> ordered;
+        std::set<std::string> visited;
+        std::function<void(const std::string &)> visit = [&](const std::string &name) {
+            if (names.count(name) == 0 || !visited.insert(name).second) return;
+            if (const auto *info = addonManager.addonInfo(name)) {
+                for (const auto &dep: info->dependencies()) visit(dep);
+                for (const auto &dep: info->optionalDependencies()) visit(dep);
+            }
+            ordered.push_back(name);
+        };
+        for (const auto &name: names) {
+            visit(name);
+        }
+        return ordered;
+    }
 
     void resetGlobalPointers() {
+        configDescCache.clear();
+        configSnapshot = {};
+        dataSnapshot = {};
         p_instance.reset();
         p_dispatcher.reset();
         p_frontend = nullptr;
-        p_quickphrase = nullptr;
-        p_unicode = nullptr;
-        p_clipboard = nullptr;
+        p_loader = nullptr;
+        quickphraseAddon.reset();
+        unicodeAddon.reset();
+        clipboardAddon.reset();
+        deferredAddons.clear();
+        currentKeyLatency = nullptr;
+        pendingKeyMicros = -1;
     }
 };
 
@@ -486,6 +804,32 @@ Java_org_fcitx_fcitx5_android_core_Fcitx_setupLogStream(JNIEnv *env, jclass claz
     Fcitx::setLogStream(stream, verbose);
 }
 
+static void registerExtDomains(JNIEnv *env, jobjectArray extDomains, const char *localeDir) {
+    const int extDomainsSize = env->GetArrayLength(extDomains);
+    for (int i = 0; i < extDomainsSize; i++) {
+        auto domain = JRef<jstring>(env, env->GetObjectArrayElement(extDomains, i));
+        fcitx::registerDomain(CString(env, domain), localeDir);
+    }
+}
+
+static fcitx::AndroidLibraryDependency libraryDependencyMap(JNIEnv *env, jobjectArray libraryNames, jobjectArray libraryDependencies) {
+    fcitx::AndroidLibraryDependency depsMap;
+    const int librarySize = env->GetArrayLength(libraryNames);
+    for (int i = 0; i < librarySize; i++) {
+        auto jstringName = JRef<jstring>(env, env->GetObjectArrayElement(libraryNames, i));
+        auto lib = CString(env, jstringName);
+        auto jobjectArrayDeps = JRef<jobjectArray>(env, env->GetObjectArrayElement(libraryDependencies, i));
+        const int depSize = env->GetArrayLength(jobjectArrayDeps);
+        std::unordered_set<std::string> depSet(depSize);
+        for (int j = 0; j < depSize; j++) {
+            auto jstringDepName = JRef<jstring>(env, env->GetObjectArrayElement(jobjectArrayDeps, j));
+            depSet.emplace(CString(env, jstringDepName));
+        }
+        depsMap.emplace(lib, depSet);
+    }
+    return depsMap;
+}
+
 extern "C"
 JNIEXPORT void JNICALL
 Java_org_fcitx_fcitx5_android_core_Fcitx_startupFcitx(
@@ -497,12 +841,16 @@ Java_org_fcitx_fcitx5_android_core_Fcitx_startupFcitx(
         jstring extCache,
         jobjectArray extDomains,
         jobjectArray libraryNames,
-        jobjectArray libraryDependencies) {
+        jobjectArray libraryDependencies,
+        jboolean deferAddons) {
     if (Fcitx::Instance().isRunning()) {
         FCITX_ERROR() << "Fcitx is already running!";
         return;
     }
     FCITX_INFO() << "Starting...";
+    auto &profile = Fcitx::Instance().profile();
+    profile.reset();
+    profile.begin("environment");
 
     auto locale_ = CString(env, locale);
     auto appData_ = CString(env, appData);
@@ -537,6 +885,7 @@ Java_org_fcitx_fcitx5_android_core_Fcitx_startupFcitx(
     setenv("LANGUAGE", locale_, 1);
     // for fcitx i18nstring loading translations in .conf files
     setenv("FCITX_LOCALE", locale_, 1);
+    Fcitx::Instance().setLocale(*locale_);
     setenv("HOME", extData_, 1);
     // system StandardPath::Type::Data
     setenv("XDG_DATA_DIRS", usr_share.c_str(), 1);
@@ -558,33 +907,21 @@ Java_org_fcitx_fcitx5_android_core_Fcitx_startupFcitx(
     setenv("XDG_RUNTIME_DIR", extCache_, 1);
     setenv("LUA_PATH", lua_path.c_str(), 1);
     setenv("LUA_CPATH", lua_cpath.c_str(), 1);
+    profile.end();
 
+    profile.begin("domains");
     const char *locale_dir_char = locale_dir.c_str();
     fcitx::registerDomain("fcitx5", locale_dir_char);
     fcitx::registerDomain("fcitx5-lua", locale_dir_char);
     fcitx::registerDomain("fcitx5-chinese-addons", locale_dir_char);
     fcitx::registerDomain("fcitx5-android", locale_dir_char);
 
-    const int extDomainsSize = env->GetArrayLength(extDomains);
-    for (int i = 0; i < extDomainsSize; i++) {
-        auto domain = JRef<jstring>(env, env->GetObjectArrayElement(extDomains, i));
-        fcitx::registerDomain(CString(env, domain), locale_dir_char);
-    }
+    registerExtDomains(env, extDomains, locale_dir_char);
+    profile.end();
 
-    std::unordered_map<std::string, std::unordered_set<std::string>> depsMap;
-    const int librarySize = env->GetArrayLength(libraryNames);
-    for (int i = 0; i < librarySize; i++) {
-        auto jstringName = JRef<jstring>(env, env->GetObjectArrayElement(libraryNames, i));
-        auto lib = CString(env, jstringName);
-        auto jobjectArrayDeps = JRef<jobjectArray>(env, env->GetObjectArrayElement(libraryDependencies, i));
-        const int depSize = env->GetArrayLength(jobjectArrayDeps);
-        std::unordered_set<std::string> depSet(depSize);
-        for (int j = 0; j < depSize; j++) {
-            auto jstringDepName = JRef<jstring>(env, env->GetObjectArrayElement(jobjectArrayDeps, j));
-            depSet.emplace(CString(env, jstringDepName));
-        }
-        depsMap.emplace(lib, depSet);
-    }
+    profile.begin("dependencies");
+    auto depsMap = libraryDependencyMap(env, libraryNames, libraryDependencies);
+    profile.end();
 
     auto candidateListCallback = [](const std::vector<std::string> &candidates, const int size) {
         auto env = GlobalRef->AttachEnv();
@@ -600,6 +937,7 @@ Java_org_fcitx_fcitx5_android_core_Fcitx_startupFcitx(
         env->CallStaticVoidMethod(GlobalRef->Fcitx, GlobalRef->HandleFcitxEvent, 0, *vararg);
     };
     auto commitStringCallback = [](const std::string &str, const int cursor) {
+        Fcitx::Instance().keyOutput();
         auto env = GlobalRef->AttachEnv();
         auto stringCursor = JRef(env, env->NewObject(GlobalRef->Integer, GlobalRef->IntegerInit, cursor));
         auto vararg = JRef<jobjectArray>(env, env->NewObjectArray(2, GlobalRef->Object, nullptr));
@@ -608,12 +946,14 @@ Java_org_fcitx_fcitx5_android_core_Fcitx_startupFcitx(
         env->CallStaticVoidMethod(GlobalRef->Fcitx, GlobalRef->HandleFcitxEvent, 1, *vararg);
     };
     auto preeditCallback = [](const fcitx::Text &clientPreedit) {
+        Fcitx::Instance().keyOutput();
         auto env = GlobalRef->AttachEnv();
         auto vararg = JRef<jobjectArray>(env, env->NewObjectArray(1, GlobalRef->FormattedText, nullptr));
         env->SetObjectArrayElement(vararg, 0, fcitxTextToJObject(env, clientPreedit));
         env->CallStaticVoidMethod(GlobalRef->Fcitx, GlobalRef->HandleFcitxEvent, 2, *vararg);
     };
     auto inputPanelAuxCallback = [](const fcitx::Text &preedit, const fcitx::Text &auxUp, const fcitx::Text &auxDown) {
+        Fcitx::Instance().keyOutput();
         auto env = GlobalRef->AttachEnv();
         auto vararg = JRef<jobjectArray>(env, env->NewObjectArray(3, GlobalRef->FormattedText, nullptr));
         env->SetObjectArrayElement(vararg, 0, fcitxTextToJObject(env, preedit));
@@ -637,6 +977,7 @@ Java_org_fcitx_fcitx5_android_core_Fcitx_startupFcitx(
         env->CallStaticVoidMethod(GlobalRef->Fcitx, GlobalRef->HandleFcitxEvent, 5, *vararg);
     };
     auto imChangeCallback = []() {
+        Fcitx::Instance().inputMethodChanged();
         auto env = GlobalRef->AttachEnv();
         auto vararg = JRef<jobjectArray>(env, env->NewObjectArray(1, GlobalRef->Object, nullptr));
         std::unique_ptr<InputMethodStatus> status = Fcitx::Instance().inputMethodStatus();
@@ -678,7 +1019,8 @@ Java_org_fcitx_fcitx5_android_core_Fcitx_startupFcitx(
     umask(007);
     fcitx::StandardPath::global().syncUmask();
 
-    Fcitx::Instance().startup(depsMap, [&](auto *androidfrontend) {
+    profile.begin("startup");
+    Fcitx::Instance().startup(std::move(depsMap), deferAddons, [&](auto *androidfrontend) {
         FCITX_INFO() << "Setting up callback";
         readyCallback();
         androidfrontend->template call<fcitx::IAndroidFrontend::setCandidateListCallback>(candidateListCallback);
@@ -691,6 +1033,10 @@ Java_org_fcitx_fcitx5_android_core_Fcitx_startupFcitx(
         androidfrontend->template call<fcitx::IAndroidFrontend::setDeleteSurroundingCallback>(deleteSurroundingCallback);
         androidfrontend->template call<fcitx::IAndroidFrontend::setToastCallback>(toastCallback);
     });
+    profile.finish();
+    std::ostringstream report;
+    profile.print(report);
+    FCITX_INFO() << "Startup profile:\n" << report.str();
     FCITX_INFO() << "Finishing startup";
 }
 
@@ -715,6 +1061,25 @@ Java_org_fcitx_fcitx5_android_core_Fcitx_saveFcitxState(JNIEnv *env, jclass claz
     Fcitx::Instance().save();
 }
 
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_org_fcitx_fcitx5_android_core_Fcitx_softRestartFcitx(
+        JNIEnv *env, jclass clazz,
+        jstring appData,
+        jstring appLib,
+        jobjectArray extDomains,
+        jobjectArray libraryNames,
+        jobjectArray libraryDependencies,
+        jboolean dataChanged) {
+    RETURN_VALUE_IF_NOT_RUNNING(-1)
+    auto appData_ = CString(env, appData);
+    const std::string locale_dir = fcitx::stringutils::joinPath(*appData_, "usr", "share", "locale");
+    // native lib dirs of new plugins
+    setenv("FCITX_ADDON_DIRS", CString(env, appLib), 1);
+    registerExtDomains(env, extDomains, locale_dir.c_str());
+    return Fcitx::Instance().softRestart(libraryDependencyMap(env, libraryNames, libraryDependencies), dataChanged);
+}
+
 extern "C"
 JNIEXPORT void JNICALL
 Java_org_fcitx_fcitx5_android_core_Fcitx_reloadFcitxConfig(JNIEnv *env, jclass clazz) {
@@ -722,31 +1087,138 @@ Java_org_fcitx_fcitx5_android_core_Fcitx_reloadFcitxConfig(JNIEnv *env, jclass c
     Fcitx::Instance().reloadConfig();
 }
 
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+Java_org_fcitx_fcitx5_android_core_Fcitx_reloadChangedFcitxConfig(JNIEnv *env, jclass clazz) {
+    RETURN_VALUE_IF_NOT_RUNNING(nullptr)
+    const auto report = Fcitx::Instance().reloadChangedConfig();
+    jobjectArray array = env->NewObjectArray(static_cast<int>(report.size()), GlobalRef->ConfigReloadEntry, nullptr);
+    int i = 0;
+    for (const auto &entry: report) {
+        env->SetObjectArrayElement(array, i++, JRef(env, env->NewObject(GlobalRef->ConfigReloadEntry, GlobalRef->ConfigReloadEntryInit,
+                                                                        *JString(env, entry.target),
+                                                                        static_cast<jlong>(entry.durationMicros))));
+    }
+    return array;
+}
+
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+Java_org_fcitx_fcitx5_android_core_Fcitx_getFcitxStartupProfile(JNIEnv *env, jclass clazz) {
+    const auto &phases = Fcitx::Instance().profile().phases();
+    jobjectArray array = env->NewObjectArray(static_cast<int>(phases.size()), GlobalRef->StartupPhase, nullptr);
+    int i = 0;
+    for (const auto &phase: phases) {
+        env->SetObjectArrayElement(array, i++, JRef(env, env->NewObject(GlobalRef->StartupPhase, GlobalRef->StartupPhaseInit,
+                                                                        *JString(env, phase.name),
+                                                                        phase.parent,
+                                                                        static_cast<jlong>(phase.startMicros),
+                                                                        static_cast<jlong>(phase.durationMicros),
+                                                                        phase.critical)));
+    }
+    return array;
+}
+
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+Java_org_fcitx_fcitx5_android_core_Fcitx_getKeyLatencyHistograms(JNIEnv *env, jclass clazz) {
+    std::vector<jobject> histograms;
+    Fcitx::Instance().keyLatencyStats().forEach([&](const KeyLatencyStats::Entry &entry) {
+        for (int stage = 0; stage < KeyLatencyStats::StageCount; stage++) {
+            const auto snapshot = entry.stages[stage].snapshot();
+            if (snapshot.count == 0) {
+                continue;
+            }
+            const auto size = static_cast<jsize>(snapshot.buckets.size());
+            std::vector<jlong> upperBounds;
+            std::vector<jlong> counts;
+            for (const auto &bucket: snapshot.buckets) {
+                upperBounds.push_back(static_cast<jlong>(bucket.upperBound));
+                counts.push_back(static_cast<jlong>(bucket.count));
+            }
+            auto upperBoundArray = JRef<jlongArray>(env, env->NewLongArray(size));
+            env->SetLongArrayRegion(upperBoundArray, 0, size, upperBounds.data());
+            auto countArray = JRef<jlongArray>(env, env->NewLongArray(size));
+            env->SetLongArrayRegion(countArray, 0, size, counts.data());
+            histograms.push_back(env->NewObject(GlobalRef->KeyLatencyHistogram, GlobalRef->KeyLatencyHistogramInit,
+                                                *JString(env, entry.inputMethod),
+                                                *JString(env, KeyLatencyStats::StageNames[stage]),
+                                                static_cast<jlong>(snapshot.count),
+                                                static_cast<jlong>(snapshot.sum),
+                                                static_cast<jlong>(snapshot.max),
+                                                *upperBoundArray,
+                                                *countArray));
+        }
+    });
+    jobjectArray array = env->NewObjectArray(static_cast<int>(histograms.size()), GlobalRef->KeyLatencyHistogram, nullptr);
+    int i = 0;
+    for (auto obj: histograms) {
+        env->SetObjectArrayElement(array, i++, JRef(env, obj));
+    }
+    return array;
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_org_fcitx_fcitx5_android_core_Fcitx_resetKeyLatencyHistograms(JNIEnv *env, jclass clazz) {
+    Fcitx::Instance().keyLatencyStats().reset();
+}
+
 extern "C"
 JNIEXPORT void JNICALL
-Java_org_fcitx_fcitx5_android_core_Fcitx_sendKeyToFcitxString(JNIEnv *env, jclass clazz, jstring key, jint state, jboolean up, jint timestamp) {
+Java_org_fcitx_fcitx5_android_core_Fcitx_sendKeyToFcitxString(JNIEnv *env, jclass clazz, jstring key, jint state, jboolean up, jint timestamp, jlong eventTime) {
     RETURN_IF_NOT_RUNNING
-    fcitx::Key parsedKey{fcitx::Key::keySymFromString(CString(env, key)),
+    fcitx::Key parsedKey{keySymFromJString(env, key),
                          fcitx::KeyStates(static_cast<uint32_t>(state))};
-    Fcitx::Instance().sendKey(parsedKey, up, timestamp);
+    Fcitx::Instance().sendKey(parsedKey, up, timestamp, eventTime);
 }
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_org_fcitx_fcitx5_android_core_Fcitx_sendKeyToFcitxChar(JNIEnv *env, jclass clazz, jchar c, jint state, jboolean up, jint timestamp) {
+Java_org_fcitx_fcitx5_android_core_Fcitx_sendKeyToFcitxChar(JNIEnv *env, jclass clazz, jchar c, jint state, jboolean up, jint timestamp, jlong eventTime) {
     RETURN_IF_NOT_RUNNING
-    const fcitx::Key parsedKey{fcitx::Key::keySymFromString(reinterpret_cast<const char *>(&c)),
+    const auto ch = static_cast<char16_t>(c);
+    // a lone surrogate is not a character
+    const auto codePoint = singleCodePoint(&ch, 1);
+    const fcitx::Key parsedKey{codePoint ? fcitx::Key::keySymFromUnicode(codePoint) : FcitxKey_None,
                                fcitx::KeyStates(static_cast<uint32_t>(state))};
-    Fcitx::Instance().sendKey(parsedKey, up, timestamp);
+    Fcitx::Instance().sendKey(parsedKey, up, timestamp, eventTime);
 }
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_org_fcitx_fcitx5_android_core_Fcitx_sendKeySymToFcitx(JNIEnv *env, jclass clazz, jint sym, jint state, jboolean up, jint timestamp) {
+Java_org_fcitx_fcitx5_android_core_Fcitx_sendKeySymToFcitx(JNIEnv *env, jclass clazz, jint sym, jint state, jboolean up, jint timestamp, jlong eventTime) {
     RETURN_IF_NOT_RUNNING
     fcitx::Key key{fcitx::KeySym(static_cast<uint32_t>(sym)),
                    fcitx::KeyStates(static_cast<uint32_t>(state))};
-    Fcitx::Instance().sendKey(key, up, timestamp);
+    Fcitx::Instance().sendKey(key, up, timestamp, eventTime);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_org_fcitx_fcitx5_android_core_Fcitx_sendKeysToFcitx(JNIEnv *env, jclass clazz, jintArray keys) {
+    RETURN_IF_NOT_RUNNING
+    // sym, state, up, timestamp
+    constexpr jsize Fields = 4;
+    constexpr jsize ChunkSize = 32 * Fields;
+    const jsize length = env->GetArrayLength(keys);
+    if (length % Fields != 0) {
+        throwJavaException(env, "Key event array length is not a multiple of 4");
+        return;
+    }
+    // copy in chunks, array elements cannot be pinned while callbacks call into JVM
+    jint buf[ChunkSize];
+    for (jsize offset = 0; offset < length; offset += ChunkSize) {
+        const jsize size = std::min(length - offset, ChunkSize);
+        env->GetIntArrayRegion(keys, offset, size, buf);
+        for (jsize i = 0; i < size; i += Fields) {
+            const fcitx::Key key{fcitx::KeySym(static_cast<uint32_t>(buf[i])),
+                                 fcitx::KeyStates(static_cast<uint32_t>(buf[i + 1]))};
+            Fcitx::Instance().sendKey(key, buf[i + 2] != 0, buf[i + 3]);
+        }
+    }
+    // input panel updates are coalesced by fcitx, flush once so that only the final state is emitted
+    Fcitx::Instance().flushUI();
 }
 
 extern "C"
@@ -850,7 +1322,7 @@ JNIEXPORT jobject JNICALL
 Java_org_fcitx_fcitx5_android_core_Fcitx_getFcitxGlobalConfig(JNIEnv *env, jclass clazz) {
     RETURN_VALUE_IF_NOT_RUNNING(nullptr)
     auto cfg = Fcitx::Instance().getGlobalConfig();
-    return fcitxRawConfigToJObject(env, *cfg);
+    return flatConfigToJObject(env, *cfg);
 }
 
 extern "C"
@@ -858,7 +1330,7 @@ JNIEXPORT jobject JNICALL
 Java_org_fcitx_fcitx5_android_core_Fcitx_getFcitxAddonConfig(JNIEnv *env, jclass clazz, jstring addon) {
     RETURN_VALUE_IF_NOT_RUNNING(nullptr)
     auto result = Fcitx::Instance().getAddonConfig(CString(env, addon));
-    return result ? fcitxRawConfigToJObject(env, *result) : nullptr;
+    return result ? flatConfigToJObject(env, *result) : nullptr;
 }
 
 extern "C"
@@ -866,7 +1338,7 @@ JNIEXPORT jobject JNICALL
 Java_org_fcitx_fcitx5_android_core_Fcitx_getFcitxAddonSubConfig(JNIEnv *env, jclass clazz, jstring addon, jstring path) {
     RETURN_VALUE_IF_NOT_RUNNING(nullptr)
     auto result = Fcitx::Instance().getAddonSubConfig(CString(env, addon), CString(env, path));
-    return result ? fcitxRawConfigToJObject(env, *result) : nullptr;
+    return result ? flatConfigToJObject(env, *result) : nullptr;
 }
 
 extern "C"
@@ -874,39 +1346,55 @@ JNIEXPORT jobject JNICALL
 Java_org_fcitx_fcitx5_android_core_Fcitx_getFcitxInputMethodConfig(JNIEnv *env, jclass clazz, jstring im) {
     RETURN_VALUE_IF_NOT_RUNNING(nullptr)
     auto result = Fcitx::Instance().getInputMethodConfig(CString(env, im));
-    return result ? fcitxRawConfigToJObject(env, *result) : nullptr;
+    return result ? flatConfigToJObject(env, *result) : nullptr;
 }
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_org_fcitx_fcitx5_android_core_Fcitx_setFcitxGlobalConfig(JNIEnv *env, jclass clazz, jobject config) {
+Java_org_fcitx_fcitx5_android_core_Fcitx_setFcitxGlobalConfig(JNIEnv *env, jclass clazz, jintArray nodes, jbyteArray pool) {
     RETURN_IF_NOT_RUNNING
-    auto rawConfig = jobjectToRawConfig(env, config);
-    Fcitx::Instance().setGlobalConfig(rawConfig);
+    try {
+        auto rawConfig = flatConfigArraysToRawConfig(env, nodes, pool);
+        Fcitx::Instance().setGlobalConfig(rawConfig);
+    } catch (const std::exception &e) {
+        throwJavaException(env, e.what());
+    }
 }
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_org_fcitx_fcitx5_android_core_Fcitx_setFcitxAddonConfig(JNIEnv *env, jclass clazz, jstring addon, jobject config) {
+Java_org_fcitx_fcitx5_android_core_Fcitx_setFcitxAddonConfig(JNIEnv *env, jclass clazz, jstring addon, jintArray nodes, jbyteArray pool) {
     RETURN_IF_NOT_RUNNING
-    auto rawConfig = jobjectToRawConfig(env, config);
-    Fcitx::Instance().setAddonConfig(CString(env, addon), rawConfig);
+    try {
+        auto rawConfig = flatConfigArraysToRawConfig(env, nodes, pool);
+        Fcitx::Instance().setAddonConfig(CString(env, addon), rawConfig);
+    } catch (const std::exception &e) {
+        throwJavaException(env, e.what());
+    }
 }
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_org_fcitx_fcitx5_android_core_Fcitx_setFcitxAddonSubConfig(JNIEnv *env, jclass clazz, jstring addon, jstring path, jobject config) {
+Java_org_fcitx_fcitx5_android_core_Fcitx_setFcitxAddonSubConfig(JNIEnv *env, jclass clazz, jstring addon, jstring path, jintArray nodes, jbyteArray pool) {
     RETURN_IF_NOT_RUNNING
-    auto rawConfig = jobjectToRawConfig(env, config);
-    Fcitx::Instance().setAddonSubConfig(CString(env, addon), CString(env, path), rawConfig);
+    try {
+        auto rawConfig = flatConfigArraysToRawConfig(env, nodes, pool);
+        Fcitx::Instance().setAddonSubConfig(CString(env, addon), CString(env, path), rawConfig);
+    } catch (const std::exception &e) {
+        throwJavaException(env, e.what());
+    }
 }
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_org_fcitx_fcitx5_android_core_Fcitx_setFcitxInputMethodConfig(JNIEnv *env, jclass clazz, jstring im, jobject config) {
+Java_org_fcitx_fcitx5_android_core_Fcitx_setFcitxInputMethodConfig(JNIEnv *env, jclass clazz, jstring im, jintArray nodes, jbyteArray pool) {
     RETURN_IF_NOT_RUNNING
-    auto rawConfig = jobjectToRawConfig(env, config);
-    Fcitx::Instance().setInputMethodConfig(CString(env, im), rawConfig);
+    try {
+        auto rawConfig = flatConfigArraysToRawConfig(env, nodes, pool);
+        Fcitx::Instance().setInputMethodConfig(CString(env, im), rawConfig);
+    } catch (const std::exception &e) {
+        throwJavaException(env, e.what());
+    }
 }
 
 extern "C"
@@ -992,6 +1480,13 @@ Java_org_fcitx_fcitx5_android_core_Fcitx_setCapabilityFlags(JNIEnv *env, jclass
     Fcitx::Instance().setCapabilityFlags(static_cast<uint64_t>(flags));
 }
 
+extern "C"
+JNIEXPORT void JNICALL
+Java_org_fcitx_fcitx5_android_core_Fcitx_setFcitxSurroundingText(JNIEnv *env, jclass clazz, jstring text, jint cursor, jint anchor) {
+    RETURN_IF_NOT_RUNNING
+    Fcitx::Instance().setSurroundingText(CString(env, text), cursor, anchor);
+}
+
 extern "C"
 JNIEXPORT jobjectArray JNICALL
 Java_org_fcitx_fcitx5_android_core_Fcitx_getFcitxStatusAreaActions(JNIEnv *env, jclass clazz) {
@@ -1070,42 +1565,161 @@ Java_org_fcitx_fcitx5_android_core_Key_create(JNIEnv *env, jclass clazz, jint sy
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_org_fcitx_fcitx5_android_data_pinyin_PinyinDictManager_pinyinDictConv(JNIEnv *env, jclass clazz, jstring src, jstring dest, jboolean mode) {
+Java_org_fcitx_fcitx5_android_data_pinyin_PinyinDictManager_pinyinDictConv(JNIEnv *env, jclass clazz, jstring src, jstring dest, jboolean mode, jobject listener) {
     using namespace libime;
-    PinyinDictionary dict;
+    const std::string srcPath = CString(env, src);
+    const std::string destPath = CString(env, dest);
     try {
-        dict.load(PinyinDictionary::SystemDict, *CString(env, src),
-                  mode == JNI_TRUE ? PinyinDictFormat::Binary : PinyinDictFormat::Text);
-        std::ofstream out;
-        out.open(*CString(env, dest), std::ios::out | std::ios::binary);
-        dict.save(PinyinDictionary::SystemDict, out,
-                  mode == JNI_TRUE ? PinyinDictFormat::Text : PinyinDictFormat::Binary);
+        if (mode == JNI_TRUE) {
+            PinyinDictionary dict;
+            dict.load(PinyinDictionary::SystemDict, srcPath.c_str(), PinyinDictFormat::Binary);
+            std::ofstream out(destPath, std::ios::out | std::ios::binary);
+            dict.save(PinyinDictionary::SystemDict, out, PinyinDictFormat::Text);
+            return;
+        }
+        std::ifstream in(srcPath, std::ios::in | std::ios::binary);
+        if (!in) {
+            throw std::runtime_error("Cannot open " + srcPath);
+        }
+        in.seekg(0, std::ios::end);
+        const auto total = static_cast<uint64_t>(in.tellg());
+        in.seekg(0, std::ios::beg);
+        DictConvProgress progress(jobjectToProgressCallback(env, listener), total);
+        DATrie<float> trie;
+        addPinyinTextToTrie(trie, in, progress);
+        std::ofstream out(destPath, std::ios::out | std::ios::binary);
+        savePinyinTrie(std::move(trie), out);
+    } catch (const std::exception &e) {
+        // listener may have thrown, let it propagate
+        if (!env->ExceptionCheck()) {
+            throwJavaException(env, e.what());
+        }
+    }
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_org_fcitx_fcitx5_android_data_pinyin_PinyinDictManager_sougouDictConv(JNIEnv *env, jclass clazz, jstring src, jstring dest, jboolean text, jobject listener) {
+    const std::string destPath = CString(env, dest);
+    try {
+        boost::iostreams::mapped_file_source file(*CString(env, src));
+        const std::string_view data(file.data(), file.size());
+        std::ofstream out(destPath, std::ios::out | std::ios::binary);
+        if (text == JNI_TRUE) {
+            writeScelAsText(data, out, jobjectToProgressCallback(env, listener));
+        } else {
+            libime::DATrie<float> trie;
+            addScelToTrie(trie, data, jobjectToProgressCallback(env, listener));
+            savePinyinTrie(std::move(trie), out);
+        }
+    } catch (const std::exception &e) {
+        std::remove(destPath.c_str());
+        if (!env->ExceptionCheck()) {
+            throwJavaException(env, e.what());
+        }
+    }
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_org_fcitx_fcitx5_android_data_pinyin_PinyinDictManager_pinyinDictBatchConv(JNIEnv *env, jclass clazz, jobjectArray srcs, jobjectArray dests, jobject listener) {
+    try {
+        batchConvertPinyinDicts(jstringArrayToStringVector(env, srcs), jstringArrayToStringVector(env, dests),
+                                jobjectToProgressCallback(env, listener));
+    } catch (const std::exception &e) {
+        // existing destinations are left untouched by a failed batch
+        if (!env->ExceptionCheck()) {
+            throwJavaException(env, e.what());
+        }
+    }
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_org_fcitx_fcitx5_android_data_pinyin_PinyinDictManager_pinyinDictDiff(JNIEnv *env, jclass clazz, jstring base, jstring result, jstring diff) {
+    using namespace libime;
+    const std::string diffPath = CString(env, diff);
+    try {
+        PinyinDictionary baseDict;
+        baseDict.load(PinyinDictionary::SystemDict, *CString(env, base), PinyinDictFormat::Binary);
+        PinyinDictionary resultDict;
+        resultDict.load(PinyinDictionary::SystemDict, *CString(env, result), PinyinDictFormat::Binary);
+        DictConvSink sink(diffPath);
+        std::ostream out(&sink);
+        const auto changed = writeDictDiff(*baseDict.trie(PinyinDictionary::SystemDict),
+                                           *resultDict.trie(PinyinDictionary::SystemDict), out);
+        sink.close();
+        return static_cast<jint>(changed);
     } catch (const std::exception &e) {
+        std::remove(diffPath.c_str());
         throwJavaException(env, e.what());
+        return -1;
     }
 }
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_org_fcitx_fcitx5_android_data_table_TableManager_tableDictConv(JNIEnv *env, jclass clazz, jstring src, jstring dest, jboolean mode) {
+Java_org_fcitx_fcitx5_android_data_pinyin_PinyinDictManager_pinyinDictPatch(JNIEnv *env, jclass clazz, jstring base, jstring diff, jstring dest) {
     using namespace libime;
-    TableBasedDictionary dict;
+    const std::string destPath = CString(env, dest);
     try {
-        dict.load(*CString(env, src), mode == JNI_TRUE ? TableFormat::Binary : TableFormat::Text);
-        std::ofstream out;
-        out.open(*CString(env, dest), std::ios::out | std::ios::binary);
-        dict.save(out, mode == JNI_TRUE ? TableFormat::Text : TableFormat::Binary);
+        PinyinDictionary dict;
+        dict.load(PinyinDictionary::SystemDict, *CString(env, base), PinyinDictFormat::Binary);
+        DATrie<float> trie(*dict.trie(PinyinDictionary::SystemDict));
+        std::ifstream in(*CString(env, diff), std::ios::in | std::ios::binary);
+        applyDictDiff(trie, in);
+        DictConvSink sink(destPath);
+        std::ostream out(&sink);
+        savePinyinTrie(std::move(trie), out);
+        sink.close();
     } catch (const std::exception &e) {
+        std::remove(destPath.c_str());
         throwJavaException(env, e.what());
     }
 }
 
+extern "C"
+JNIEXPORT void JNICALL
+Java_org_fcitx_fcitx5_android_data_table_TableManager_tableDictConv(JNIEnv *env, jclass clazz, jstring src, jstring dest, jboolean mode, jobject listener) {
+    using namespace libime;
+    const std::string destPath = CString(env, dest);
+    try {
+        TableBasedDictionary dict;
+        DictConvSource source(CString(env, src), jobjectToProgressCallback(env, listener));
+        std::istream in(&source);
+        dict.load(in, mode == JNI_TRUE ? TableFormat::Binary : TableFormat::Text);
+        source.throwIfCancelled();
+        DictConvSink sink(destPath);
+        std::ostream out(&sink);
+        dict.save(out, mode == JNI_TRUE ? TableFormat::Text : TableFormat::Binary);
+        sink.close();
+        source.finish();
+    } catch (const std::exception &e) {
+        std::remove(destPath.c_str());
+        if (!env->ExceptionCheck()) {
+            throwJavaException(env, e.what());
+        }
+    }
+}
+
 extern "C"
 JNIEXPORT jboolean JNICALL
-Java_org_fcitx_fcitx5_android_data_table_TableManager_checkTableDictFormat(JNIEnv *env, jclass clazz, jstring src, jboolean user) {
+Java_org_fcitx_fcitx5_android_data_table_TableManager_checkTableDictFormat(JNIEnv *env, jclass clazz, jstring src, jboolean user, jboolean deep) {
     using namespace libime;
     TableBasedDictionary dict;
     try {
+        if (deep != JNI_TRUE) {
+            boost::iostreams::mapped_file_source file(*CString(env, src));
+            const auto result = TableDictChecker(std::string_view(file.data(), file.size()), user == JNI_TRUE).check();
+            if (result == TableDictCheckResult::Valid) {
+                return JNI_TRUE;
+            }
+            if (result == TableDictCheckResult::Invalid) {
+                throwJavaException(env, "Truncated or corrupted table dictionary");
+                return JNI_FALSE;
+            }
+            // unknown header, fallback to full load for a definite answer
+        }
         if (user == JNI_TRUE) {
             dict.loadUser(CString(env, src), TableFormat::Binary);
         } else {
@@ -1117,88 +1731,212 @@ Java_org_fcitx_fcitx5_android_data_table_TableManager_checkTableDictFormat(JNIEn
     return JNI_TRUE;
 }
 
+static std::mutex customPhraseMutex;
+
+/**
+ * open custom phrase store, and re-import the text file if it has been changed since last sync
+ * @param sync check the text file even if the store is already open; ids of phrases change on re-import
+ */
+static CustomPhraseStore &openCustomPhraseStore(bool sync = true) {
+    const auto &sp = fcitx::StandardPath::global();
+    const auto pinyinDir = sp.userDirectory(fcitx::StandardPath::Type::PkgData) + "/pinyin";
+    static CustomPhraseStore store(pinyinDir + "/customphrase.store");
+    if (store.isOpen() && !sync) {
+        return store;
+    }
+    const auto textPath = sp.locate(fcitx::StandardPath::Type::PkgData, "pinyin/customphrase");
+    uint64_t mtime;
+    uint64_t size;
+    const bool hasText = CustomPhraseStore::textStamp(textPath, mtime, size);
+    if (!store.isOpen()) {
+        store.open();
+    }
+    if (!store.syncedWith(mtime, size)) {
+        fcitx::fs::makePath(pinyinDir);
+        std::ifstream in;
+        if (hasText) {
+            in.open(textPath, std::ios::in | std::ios::binary);
+        }
+        store.importText(in, mtime, size);
+    }
+    return store;
+}
+
+template<typename Iter>
+static jobjectArray customPhraseArray(JNIEnv *env, const CustomPhraseStore &store, Iter begin, Iter end) {
+    jobjectArray array = env->NewObjectArray(static_cast<int>(end - begin), GlobalRef->PinyinCustomPhrase, nullptr);
+    int i = 0;
+    for (auto iter = begin; iter != end; ++iter) {
+        const auto item = store.entry(*iter);
+        env->SetObjectArrayElement(array, i++,
+                                   JRef(env, env->NewObject(GlobalRef->PinyinCustomPhrase, GlobalRef->PinyinCustomPhraseInit,
+                                                            *JString(env, std::string(item.key)),
+                                                            item.order,
+                                                            *JString(env, std::string(item.value)),
+                                                            static_cast<jint>(*iter)
+                                        )
+                                   )
+        );
+    }
+    return array;
+}
+
+/**
+ * ids matching last query, so that paging through one query does not filter the store again
+ */
+static struct {
+    std::string keyPrefix;
+    std::string valueSubstring;
+    uint64_t generation = 0;
+    bool valid = false;
+    std::vector<uint32_t> ids;
+} customPhraseQuery;
+
+static const std::vector<uint32_t> &queryCustomPhrase(CustomPhraseStore &store,
+                                                      const std::string &keyPrefix,
+                                                      const std::string &valueSubstring) {
+    if (keyPrefix.empty() && valueSubstring.empty()) {
+        return store.live();
+    }
+    auto &q = customPhraseQuery;
+    if (!q.valid || q.generation != store.generation() || q.keyPrefix != keyPrefix || q.valueSubstring != valueSubstring) {
+        q.ids = store.query(keyPrefix, valueSubstring);
+        q.keyPrefix = keyPrefix;
+        q.valueSubstring = valueSubstring;
+        q.generation = store.generation();
+        q.valid = true;
+    }
+    return q.ids;
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_org_fcitx_fcitx5_android_data_pinyin_CustomPhraseManager_open(JNIEnv *env, jclass clazz) {
+    std::lock_guard<std::mutex> lock(customPhraseMutex);
+    try {
+        auto &store = openCustomPhraseStore();
+        // ids are handed out again after this, so this is where they can be renumbered
+        if (store.shouldCompact()) {
+            store.compact();
+        }
+        return JNI_TRUE;
+    } catch (const std::exception &e) {
+        FCITX_WARN() << "cannot load pinyin/customphrase: " << e.what();
+        return JNI_FALSE;
+    }
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_org_fcitx_fcitx5_android_data_pinyin_CustomPhraseManager_count(JNIEnv *env, jclass clazz, jstring keyPrefix, jstring valueSubstring) {
+    std::lock_guard<std::mutex> lock(customPhraseMutex);
+    try {
+        auto &store = openCustomPhraseStore(false);
+        return static_cast<jint>(queryCustomPhrase(store, CString(env, keyPrefix), CString(env, valueSubstring)).size());
+    } catch (const std::exception &e) {
+        FCITX_WARN() << "cannot load pinyin/customphrase: " << e.what();
+        return 0;
+    }
+}
+
 extern "C"
 JNIEXPORT jobjectArray JNICALL
-Java_org_fcitx_fcitx5_android_data_pinyin_CustomPhraseManager_load(JNIEnv *env, jclass clazz) {
-    auto fp = fcitx::StandardPath::global().open(fcitx::StandardPath::Type::PkgData, "pinyin/customphrase", O_RDONLY);
-    if (fp.fd() < 0) {
-        FCITX_INFO() << "cannot open pinyin/customphrase";
+Java_org_fcitx_fcitx5_android_data_pinyin_CustomPhraseManager_get(JNIEnv *env, jclass clazz, jint offset, jint limit, jstring keyPrefix, jstring valueSubstring) {
+    std::lock_guard<std::mutex> lock(customPhraseMutex);
+    try {
+        auto &store = openCustomPhraseStore(false);
+        const auto &ids = queryCustomPhrase(store, CString(env, keyPrefix), CString(env, valueSubstring));
+        const auto begin = std::min(ids.size(), static_cast<size_t>(std::max(offset, 0)));
+        const auto end = std::min(ids.size(), begin + static_cast<size_t>(std::max(limit, 0)));
+        return customPhraseArray(env, store, ids.begin() + begin, ids.begin() + end);
+    } catch (const std::exception &e) {
+        FCITX_WARN() << "cannot load pinyin/customphrase: " << e.what();
         return nullptr;
     }
-    boost::iostreams::stream_buffer<boost::iostreams::file_descriptor_source>
-            buffer(fp.fd(), boost::iostreams::file_descriptor_flags::never_close_handle);
-    std::istream in(&buffer);
-    fcitx::CustomPhraseDict dict;
-    dict.load(in, true);
-    int size = 0;
-    dict.foreach([&](const std::string &key, std::vector<fcitx::CustomPhrase> &items) {
-        FCITX_UNUSED(key);
-        size += static_cast<int>(items.size());
-    });
-    int i = 0;
-    jobjectArray array = env->NewObjectArray(size, GlobalRef->PinyinCustomPhrase, nullptr);
-    dict.foreach([&](const std::string &key, std::vector<fcitx::CustomPhrase> &items) {
-        for (const auto &item: items) {
-            env->SetObjectArrayElement(array, i++,
-                                       JRef(env, env->NewObject(GlobalRef->PinyinCustomPhrase, GlobalRef->PinyinCustomPhraseInit,
-                                                                *JString(env, key),
-                                                                item.order(),
-                                                                *JString(env, item.value())
-                                            )
-                                       )
-            );
-        }
-    });
-    return array;
 }
 
 extern "C"
-JNIEXPORT void JNICALL
-Java_org_fcitx_fcitx5_android_data_pinyin_CustomPhraseManager_save(JNIEnv *env, jclass clazz, jobjectArray items) {
-    fcitx::CustomPhraseDict dict;
-    const int size = env->GetArrayLength(items);
-    for (int i = 0; i < size; i++) {
-        auto phrase = JRef(env, env->GetObjectArrayElement(items, i));
-        auto phraseKey = JRef<jstring>(env, env->GetObjectField(phrase, GlobalRef->PinyinCustomPhraseKey));
-        auto phraseOrder = env->GetIntField(phrase, GlobalRef->PinyinCustomPhraseOrder);
-        auto phraseValue = JRef<jstring>(env, env->GetObjectField(phrase, GlobalRef->PinyinCustomPhraseValue));
-        dict.addPhrase(*CString(env, phraseKey),
-                       *CString(env, phraseValue),
-                       static_cast<int>(phraseOrder));
-    }
-    fcitx::StandardPath::global().safeSave(
-            fcitx::StandardPath::Type::PkgData, "pinyin/customphrase",
-            [&](int fd) {
-                boost::iostreams::stream_buffer<boost::iostreams::file_descriptor_sink>
-                        buffer(fd, boost::iostreams::file_descriptor_flags::never_close_handle);
-                std::ostream out(&buffer);
-                dict.save(out);
-                return true;
-            });
+JNIEXPORT jintArray JNICALL
+Java_org_fcitx_fcitx5_android_data_pinyin_CustomPhraseManager_edit(JNIEnv *env, jclass clazz, jintArray removed, jobjectArray updated, jobjectArray added) {
+    // one lock for the whole batch, so that open() cannot renumber ids in the middle of it
+    std::lock_guard<std::mutex> lock(customPhraseMutex);
+    try {
+        auto &store = openCustomPhraseStore(false);
+        const auto removedCount = env->GetArrayLength(removed);
+        std::vector<jint> removedIds(removedCount);
+        env->GetIntArrayRegion(removed, 0, removedCount, removedIds.data());
+        for (const auto id: removedIds) {
+            if (id >= 0) {
+                store.remove(static_cast<uint32_t>(id));
+            }
+        }
+        const auto updatedCount = env->GetArrayLength(updated);
+        for (int i = 0; i < updatedCount; i++) {
+            auto phrase = JRef(env, env->GetObjectArrayElement(updated, i));
+            const auto id = env->GetIntField(phrase, GlobalRef->PinyinCustomPhraseId);
+            if (id < 0) continue;
+            auto key = JRef<jstring>(env, env->GetObjectField(phrase, GlobalRef->PinyinCustomPhraseKey));
+            auto value = JRef<jstring>(env, env->GetObjectField(phrase, GlobalRef->PinyinCustomPhraseValue));
+            store.update(static_cast<uint32_t>(id), *CString(env, key),
+                         env->GetIntField(phrase, GlobalRef->PinyinCustomPhraseOrder), *CString(env, value));
+        }
+        const auto addedCount = env->GetArrayLength(added);
+        std::vector<jint> addedIds(addedCount);
+        for (int i = 0; i < addedCount; i++) {
+            auto phrase = JRef(env, env->GetObjectArrayElement(added, i));
+            auto key = JRef<jstring>(env, env->GetObjectField(phrase, GlobalRef->PinyinCustomPhraseKey));
+            auto value = JRef<jstring>(env, env->GetObjectField(phrase, GlobalRef->PinyinCustomPhraseValue));
+            addedIds[i] = static_cast<jint>(store.add(*CString(env, key),
+                                                      env->GetIntField(phrase, GlobalRef->PinyinCustomPhraseOrder),
+                                                      *CString(env, value)));
+        }
+        const auto &sp = fcitx::StandardPath::global();
+        store.commitText(sp.userDirectory(fcitx::StandardPath::Type::PkgData) + "/pinyin/customphrase");
+        jintArray result = env->NewIntArray(addedCount);
+        env->SetIntArrayRegion(result, 0, addedCount, addedIds.data());
+        return result;
+    } catch (const std::exception &e) {
+        FCITX_WARN() << "cannot save pinyin/customphrase: " << e.what();
+        return nullptr;
+    }
 }
 
 extern "C"
 JNIEXPORT jobject JNICALL
 Java_org_fcitx_fcitx5_android_utils_Ini_readFromIni(JNIEnv *env, jclass clazz, jstring src) {
-    fcitx::RawConfig config;
-    FILE *fp = std::fopen(*CString(env, src), "rb");
-    if (!fp) {
+    const std::string path = CString(env, src);
+    struct stat st{};
+    if (stat(path.c_str(), &st) != 0) {
+        return nullptr;
+    }
+    try {
+        // mapping an empty file fails
+        if (st.st_size == 0) {
+            return flatConfigToJObject(env, IniReader({}).read());
+        }
+        boost::iostreams::mapped_file_source file(path);
+        return flatConfigToJObject(env, IniReader(std::string_view(file.data(), file.size())).read());
+    } catch (const std::exception &e) {
+        FCITX_WARN() << "cannot read " << path << ": " << e.what();
         return nullptr;
     }
-    fcitx::readFromIni(config, fp);
-    std::fclose(fp);
-    return fcitxRawConfigToJObject(env, config);
 }
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_org_fcitx_fcitx5_android_utils_Ini_writeAsIni(JNIEnv *env, jclass clazz, jstring dest, jobject value) {
+Java_org_fcitx_fcitx5_android_utils_Ini_writeAsIni(JNIEnv *env, jclass clazz, jstring dest, jintArray nodes, jbyteArray pool) {
+    fcitx::RawConfig config;
+    try {
+        config = flatConfigArraysToRawConfig(env, nodes, pool);
+    } catch (const std::exception &e) {
+        throwJavaException(env, e.what());
+        return;
+    }
     FILE *fp = std::fopen(*CString(env, dest), "wb");
     if (!fp) {
         throwJavaException(env, "Unable to open file");
         return;
     }
-    auto config = jobjectToRawConfig(env, value);
     fcitx::writeAsIni(config, fp);
     std::fclose(fp);
 }
@@ -8,10 +8,12 @@
 #include <array>
 #include <streambuf>
 
-#include <android/log.h>
+#include "async-log-sink.h"
 
 template<std::size_t SIZE = 128>
 class native_streambuf : public std::streambuf {
+    static_assert(SIZE <= AsyncLogSink::MaxLineLength, "log sink would truncate lines");
+
 public:
     using Base = std::streambuf;
     using char_type = typename Base::char_type;
@@ -95,8 +97,16 @@ private:
         }
     }
 
+    // leaked on purpose: destructors of other statics may still log while the process exits,
+    // after a function-local static sink would have been destroyed and its thread joined
+    static AsyncLogSink &sink() {
+        static auto *instance = new AsyncLogSink("fcitx5");
+        return *instance;
+    }
+
+    // logcat is written on another thread, so that logging does not block the caller
     void write_log(const char_type *text) const {
-        __android_log_write(prio, "fcitx5", text + (should_offset ? 1 : 0));
+        sink().write(prio, text + (should_offset ? 1 : 0));
     }
 };
 
@@ -11,6 +11,8 @@
 
 #include "jni-utils.h"
 #include "helper-types.h"
+#include "dict-conv.h"
+#include "flat-config.h"
 
 jobject fcitxInputMethodEntryToJObject(JNIEnv *env, const fcitx::InputMethodEntry *entry) {
     return env->NewObject(GlobalRef->InputMethodEntry, GlobalRef->InputMethodEntryInit,
@@ -51,44 +53,26 @@ jobject fcitxInputMethodStatusToJObject(JNIEnv *env, const InputMethodStatus &st
     );
 }
 
-jobject fcitxRawConfigToJObject(JNIEnv *env, const fcitx::RawConfig &cfg) {
-    jobject obj = env->NewObject(GlobalRef->RawConfig, GlobalRef->RawConfigInit,
-                                 *JString(env, cfg.name()),
-                                 *JString(env, cfg.comment()),
-                                 *JString(env, cfg.value()),
-                                 nullptr);
-    if (!cfg.hasSubItems()) {
-        return obj;
-    }
-    auto array = JRef<jobjectArray>(env, env->NewObjectArray(static_cast<int>(cfg.subItemsSize()), GlobalRef->RawConfig, nullptr));
-    int i = 0;
-    for (const auto &item: cfg.subItems()) {
-        auto jItem = JRef(env, fcitxRawConfigToJObject(env, *cfg.get(item)));
-        env->SetObjectArrayElement(array, i++, jItem);
-    }
-    env->CallVoidMethod(obj, GlobalRef->RawConfigSetSubItems, *array);
-    return obj;
-}
-
-void jobjectFillRawConfig(JNIEnv *env, jobject jConfig, fcitx::RawConfig &config) {
-    auto subItems = JRef<jobjectArray>(env, env->GetObjectField(jConfig, GlobalRef->RawConfigSubItems));
-    if (*subItems == nullptr) {
-        auto value = JRef<jstring>(env, env->GetObjectField(jConfig, GlobalRef->RawConfigValue));
-        config = CString(env, value);
-    } else {
-        int size = env->GetArrayLength(subItems);
-        for (int i = 0; i < size; i++) {
-            auto item = JRef(env, env->GetObjectArrayElement(subItems, i));
-            auto name = JRef<jstring>(env, env->GetObjectField(item, GlobalRef->RawConfigName));
-            auto subConfig = config.get(CString(env, name), true);
-            jobjectFillRawConfig(env, item, *subConfig);
-        }
-    }
+jobject flatConfigToJObject(JNIEnv *env, const FlatConfig &config) {
+    const auto &nodes = config.nodes();
+    const auto &pool = config.pool();
+    auto jNodes = JRef<jintArray>(env, env->NewIntArray(static_cast<int>(nodes.size())));
+    env->SetIntArrayRegion(jNodes, 0, static_cast<int>(nodes.size()), nodes.data());
+    auto jPool = JRef<jbyteArray>(env, env->NewByteArray(static_cast<int>(pool.size())));
+    env->SetByteArrayRegion(jPool, 0, static_cast<int>(pool.size()), reinterpret_cast<const jbyte *>(pool.data()));
+    return env->CallStaticObjectMethod(GlobalRef->RawConfig, GlobalRef->RawConfigFromFlat, *jNodes, *jPool);
 }
 
-fcitx::RawConfig jobjectToRawConfig(JNIEnv *env, jobject jConfig) {
+/**
+ * @throw std::invalid_argument if arrays are not a valid flat config
+ */
+fcitx::RawConfig flatConfigArraysToRawConfig(JNIEnv *env, jintArray nodes, jbyteArray pool) {
+    std::vector<int32_t> nodesVector(env->GetArrayLength(nodes));
+    env->GetIntArrayRegion(nodes, 0, static_cast<int>(nodesVector.size()), nodesVector.data());
+    std::string poolString(env->GetArrayLength(pool), '\0');
+    env->GetByteArrayRegion(pool, 0, static_cast<int>(poolString.size()), reinterpret_cast<jbyte *>(poolString.data()));
     fcitx::RawConfig config;
-    jobjectFillRawConfig(env, jConfig, config);
+    fillRawConfig(FlatConfig(std::move(nodesVector), std::move(poolString)), config);
     return config;
 }
 
@@ -101,6 +85,17 @@ jobjectArray stringVectorToJStringArray(JNIEnv *env, const std::vector<std::stri
     return array;
 }
 
+std::vector<std::string> jstringArrayToStringVector(JNIEnv *env, jobjectArray array) {
+    const int size = env->GetArrayLength(array);
+    std::vector<std::string> strings;
+    strings.reserve(size);
+    for (int i = 0; i < size; i++) {
+        auto str = JRef<jstring>(env, env->GetObjectArrayElement(array, i));
+        strings.emplace_back(CString(env, str));
+    }
+    return strings;
+}
+
 jobject fcitxAddonStatusToJObject(JNIEnv *env, const AddonStatus &status) {
     const auto info = status.info;
     return env->NewObject(GlobalRef->AddonInfo, GlobalRef->AddonInfoInit,
@@ -161,4 +156,16 @@ jobject fcitxTextToJObject(JNIEnv *env, const fcitx::Text &text) {
     return obj;
 }
 
+DictConvProgressCallback jobjectToProgressCallback(JNIEnv *env, jobject listener) {
+    if (!listener) {
+        return {};
+    }
+    return [env, listener](uint64_t processed, uint64_t total) {
+        const jboolean proceed = env->CallBooleanMethod(listener, GlobalRef->ProgressListenerOnProgress,
+                                                        static_cast<jlong>(processed), static_cast<jlong>(total));
+        // treat exception thrown by listener as cancellation
+        return !env->ExceptionCheck() && proceed == JNI_TRUE;
+    };
+}
+
 #endif //FCITX5_ANDROID_OBJECT_CONVERSION_H
@@ -0,0 +1,244 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef FCITX5_ANDROID_PINYIN_DICT_BATCH_H
+#define FCITX5_ANDROID_PINYIN_DICT_BATCH_H
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <libime/pinyin/pinyindictionary.h>
+
+#include "dict-conv.h"
+#include "scel-dict.h"
+
+enum class PinyinDictSource {
+    Text,
+    Scel,
+    Binary
+};
+
+inline PinyinDictSource pinyinDictSourceOf(const std::string &path) {
+    const auto endsWith = [&](std::string_view suffix) {
+        return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    if (endsWith(".txt")) {
+        return PinyinDictSource::Text;
+    }
+    if (endsWith(".scel")) {
+        return PinyinDictSource::Scel;
+    }
+    return PinyinDictSource::Binary;
+}
+
+/**
+ * Add entries of a pinyin dictionary file in any supported format to `trie`.
+ * Entries already in `trie` are overwritten.
+ */
+inline void addPinyinDictFileToTrie(libime::DATrie<float> &trie, const std::string &path, DictConvProgressCallback callback) {
+    switch (pinyinDictSourceOf(path)) {
+        case PinyinDictSource::Text: {
+            std::ifstream in(path, std::ios::in | std::ios::binary);
+            if (!in) {
+                throw std::runtime_error("Cannot open " + path);
+            }
+            in.seekg(0, std::ios::end);
+            DictConvProgress progress(std::move(callback), static_cast<uint64_t>(in.tellg()));
+            in.seekg(0, std::ios::beg);
+            addPinyinTextToTrie(trie, in, progress);
+            break;
+        }
+        case PinyinDictSource::Scel: {
+            boost::iostreams::mapped_file_source file(path);
+            addScelToTrie(trie, std::string_view(file.data(), file.size()), std::move(callback));
+            break;
+        }
+        case PinyinDictSource::Binary: {
+            libime::PinyinDictionary dict;
+            dict.load(libime::PinyinDictionary::SystemDict, path.c_str(), libime::PinyinDictFormat::Binary);
+            const auto *source = dict.trie(libime::PinyinDictionary::SystemDict);
+            std::string key;
+            source->foreach([&](float value, size_t len, libime::DATrie<float>::position_type pos) {
+                source->suffix(key, len, pos);
+                trie.set(key, value);
+                return true;
+            });
+            DictConvProgress progress(std::move(callback), 1);
+            progress.finish();
+            break;
+        }
+    }
+}
+
+/**
+ * Dictionaries are saved to temporary files next to their destinations, and only renamed over them by commit(),
+ * so a failed or cancelled batch leaves existing dictionaries untouched. Temporary files not committed are
+ * removed on destruction.
+ */
+class PinyinDictBatchOutput {
+public:
+    PinyinDictBatchOutput() = default;
+
+    PinyinDictBatchOutput(const PinyinDictBatchOutput &) = delete;
+
+    ~PinyinDictBatchOutput() {
+        for (const auto &entry: entries_) {
+            std::remove(entry.temp.c_str());
+        }
+    }
+
+    void save(const std::string &dest, libime::DATrie<float> trie) {
+        auto &entry = entries_.emplace_back(Entry{createUniqueFile(dest + ".tmp."), dest, {}, false});
+        std::ofstream out(entry.temp, std::ios::out | std::ios::binary | std::ios::trunc);
+        savePinyinTrie(std::move(trie), out);
+        out.close();
+        if (!out) {
+            throw std::runtime_error("Cannot write " + dest);
+        }
+    }
+
+    /**
+     * Replace every destination. If one of them cannot be replaced, those replaced so far are restored
+     * before throwing. An old dictionary that cannot be restored is kept next to its destination.
+     */
+    void commit() {
+        size_t i = 0;
+        try {
+            for (; i < entries_.size(); i++) {
+                replace(entries_[i]);
+            }
+        } catch (...) {
+            // including the one that failed, it may have been moved away already
+            for (size_t j = i + 1; j-- > 0;) {
+                restore(entries_[j]);
+            }
+            throw;
+        }
+        for (const auto &entry: entries_) {
+            if (!entry.backup.empty()) {
+                std::remove(entry.backup.c_str());
+            }
+        }
+        entries_.clear();
+    }
+
+private:
+    struct Entry {
+        std::string temp;
+        std::string dest;
+        // old dictionary moved away from dest, empty if there was none
+        std::string backup;
+        bool replaced = false;
+    };
+
+    std::vector<Entry> entries_;
+
+    /**
+     * create an empty file with a name unique in its directory, so that entries never share one
+     */
+    static std::string createUniqueFile(const std::string &prefix) {
+        std::string path = prefix + "XXXXXX";
+        const int fd = mkstemp(path.data());
+        if (fd < 0) {
+            throw std::runtime_error("Cannot create " + path);
+        }
+        ::close(fd);
+        return path;
+    }
+
+    static void replace(Entry &entry) {
+        struct stat st{};
+        if (stat(entry.dest.c_str(), &st) == 0) {
+            auto backup = createUniqueFile(entry.dest + ".bak.");
+            if (std::rename(entry.dest.c_str(), backup.c_str()) != 0) {
+                std::remove(backup.c_str());
+                throw std::runtime_error("Cannot write " + entry.dest);
+            }
+            entry.backup = std::move(backup);
+        }
+        if (std::rename(entry.temp.c_str(), entry.dest.c_str()) != 0) {
+            throw std::runtime_error("Cannot write " + entry.dest);
+        }
+        entry.replaced = true;
+    }
+
+    static void restore(Entry &entry) {
+        if (entry.replaced && entry.backup.empty()) {
+            std::remove(entry.dest.c_str());
+        }
+        if (!entry.backup.empty() && std::rename(entry.backup.c_str(), entry.dest.c_str()) == 0) {
+            entry.backup.clear();
+        }
+        entry.replaced = false;
+    }
+};
+
+/**
+ * Convert every file in `srcs` to libime binary format.
+ *
+ * If `dests` has only one element, all sources are merged into one trie and saved to it, entries appear in
+ * more than one source are de-duplicated, and the last one wins. Otherwise `dests` must be as many as `srcs`.
+ * Progress is reported in bytes, summed over all sources. Destinations are only replaced if all of them
+ * have been converted. Destinations must be distinct, as each one can only hold one converted source.
+ */
+inline void batchConvertPinyinDicts(const std::vector<std::string> &srcs,
+                                    const std::vector<std::string> &dests,
+                                    const DictConvProgressCallback &callback) {
+    const bool merge = dests.size() == 1;
+    if (!merge && dests.size() != srcs.size()) {
+        throw std::invalid_argument("Expect one merged destination, or one destination per source");
+    }
+    std::unordered_set<std::string> seen;
+    for (const auto &dest: dests) {
+        if (!seen.insert(dest).second) {
+            throw std::invalid_argument("Duplicate destination " + dest);
+        }
+    }
+    std::vector<uint64_t> sizes;
+    uint64_t total = 0;
+    for (const auto &src: srcs) {
+        struct stat st{};
+        if (stat(src.c_str(), &st) != 0) {
+            throw std::runtime_error("Cannot open " + src);
+        }
+        sizes.push_back(static_cast<uint64_t>(st.st_size));
+        total += st.st_size;
+    }
+    PinyinDictBatchOutput output;
+    libime::DATrie<float> trie;
+    uint64_t done = 0;
+    for (size_t i = 0; i < srcs.size(); i++) {
+        DictConvProgressCallback fileCallback;
+        if (callback) {
+            // map progress of current file to overall progress
+            fileCallback = [&callback, done, size = sizes[i], total](uint64_t processed, uint64_t fileTotal) {
+                const uint64_t offset = fileTotal ? processed * size / fileTotal : size;
+                return callback(done + offset, total);
+            };
+        }
+        addPinyinDictFileToTrie(trie, srcs[i], std::move(fileCallback));
+        done += sizes[i];
+        if (!merge) {
+            output.save(dests[i], std::move(trie));
+            trie = libime::DATrie<float>();
+        }
+    }
+    if (merge) {
+        output.save(dests[0], std::move(trie));
+    }
+    output.commit();
+}
+
+#endif //FCITX5_ANDROID_PINYIN_DICT_BATCH_H
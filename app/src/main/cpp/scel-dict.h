@@ -0,0 +1,185 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef FCITX5_ANDROID_SCEL_DICT_H
+#define FCITX5_ANDROID_SCEL_DICT_H
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcitx-utils/cutf8.h>
+#include <fcitx-utils/log.h>
+
+#include "dict-conv.h"
+
+/**
+ * Reader for Sogou cell dictionary (.scel), a port of scel2org5 from fcitx5-chinese-addons
+ * that works on a buffer in memory rather than a FILE stream.
+ *
+ * Layout: 12 bytes magic, pinyin table at 0x1540, then word groups from 0x2628 (or 0x26c4).
+ * Every word group is a list of hanzi sharing the same pinyin; all strings are UTF-16LE.
+ */
+class ScelReader {
+public:
+    explicit ScelReader(std::string_view data) : data_(data) {
+        static constexpr std::string_view magic("\x40\x15\x00\x00\x44\x43\x53\x01\x01\x00\x00\x00", 12);
+        static constexpr std::string_view magic2("\x40\x15\x00\x00\x45\x43\x53\x01\x01\x00\x00\x00", 12);
+        const auto header = data_.substr(0, magic.size());
+        if (header != magic && header != magic2) {
+            throw std::runtime_error("Not a valid scel file");
+        }
+        wordOffset_ = header == magic ? 0x2628 : 0x26c4;
+        pos_ = PinyinTableOffset;
+        const auto count = readU32();
+        pinyins_.resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            const auto index = readU16();
+            const auto size = readU16();
+            if (index >= count) {
+                throw std::runtime_error("Invalid pinyin table in scel file");
+            }
+            pinyins_[index] = readUtf16(size);
+        }
+    }
+
+    [[nodiscard]] size_t size() const { return data_.size(); }
+
+    /**
+     * call `callback(hanzi, pinyin)` for every word, pinyin syllables are separated by '\''
+     * @return number of invalid words skipped
+     */
+    template<typename F>
+    size_t forEachWord(F &&callback, DictConvProgress &progress) {
+        static constexpr std::string_view deletedTable("D\0E\0L\0T\0B\0L\0", 12);
+        size_t invalid = 0;
+        std::string pinyin;
+        pos_ = wordOffset_;
+        while (pos_ + 4 <= data_.size() && data_.substr(pos_, deletedTable.size()) != deletedTable) {
+            const auto words = readU16();
+            const auto pinyinSize = readU16();
+            pinyin.clear();
+            bool valid = true;
+            for (uint16_t i = 0; i < pinyinSize / 2; i++) {
+                const auto index = readU16();
+                if (index >= pinyins_.size()) {
+                    valid = false;
+                    continue;
+                }
+                if (!pinyin.empty()) {
+                    pinyin.push_back('\'');
+                }
+                pinyin.append(pinyins_[index]);
+            }
+            for (uint16_t i = 0; i < words; i++) {
+                const auto hanzi = readUtf16(readU16());
+                // extra data, starting with word frequency
+                skip(readU16());
+                if (valid) {
+                    callback(std::string_view(hanzi), std::string_view(pinyin));
+                } else {
+                    invalid++;
+                }
+            }
+            progress.report(pos_);
+        }
+        progress.finish();
+        return invalid;
+    }
+
+private:
+    static constexpr size_t PinyinTableOffset = 0x1540;
+
+    std::string_view data_;
+    size_t pos_ = 0;
+    size_t wordOffset_ = 0;
+    std::vector<std::string> pinyins_;
+
+    void ensure(size_t size) const {
+        if (pos_ + size > data_.size()) {
+            throw std::runtime_error("Unexpected end of scel file");
+        }
+    }
+
+    void skip(size_t size) {
+        ensure(size);
+        pos_ += size;
+    }
+
+    uint16_t readU16() {
+        ensure(2);
+        const auto *p = reinterpret_cast<const uint8_t *>(data_.data() + pos_);
+        pos_ += 2;
+        return p[0] | (p[1] << 8);
+    }
+
+    uint32_t readU32() {
+        const uint32_t low = readU16();
+        return low | (static_cast<uint32_t>(readU16()) << 16);
+    }
+
+    std::string readUtf16(size_t size) {
+        ensure(size);
+        const auto end = pos_ + size - size % 2;
+        std::string result;
+        result.reserve(size * 3 / 2);
+        char buf[FCITX_UTF8_MAX_LENGTH + 1];
+        while (pos_ < end) {
+            uint32_t c = readU16();
+            if (c >= 0xd800 && c < 0xdc00 && pos_ < end) {
+                const uint32_t low = readU16();
+                c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+            }
+            result.append(buf, fcitx_ucs4_to_utf8(c, buf));
+        }
+        pos_ += size % 2;
+        return result;
+    }
+};
+
+/**
+ * Decode scel words directly into a libime pinyin trie. Entries already in `trie` are overwritten.
+ */
+inline void addScelToTrie(libime::DATrie<float> &trie, std::string_view data, DictConvProgressCallback callback) {
+    ScelReader reader(data);
+    DictConvProgress progress(std::move(callback), reader.size());
+    // reused for every word
+    EncodedPinyinChunk entry;
+    size_t invalid = reader.forEachWord([&](std::string_view hanzi, std::string_view pinyin) {
+        entry.keys.clear();
+        entry.spans.clear();
+        entry.costs.clear();
+        try {
+            encodePinyinEntry(entry, hanzi, pinyin, 0.0F);
+        } catch (const std::exception &) {
+            entry.invalid++;
+            return;
+        }
+        trie.set(entry.key(0), entry.costs[0]);
+    }, progress);
+    invalid += entry.invalid;
+    if (invalid) {
+        FCITX_WARN() << "Skipped " << invalid << " invalid scel dictionary entries";
+    }
+}
+
+/**
+ * Write scel words in libime pinyin text format
+ */
+inline void writeScelAsText(std::string_view data, std::ostream &out, DictConvProgressCallback callback) {
+    ScelReader reader(data);
+    DictConvProgress progress(std::move(callback), reader.size());
+    const auto invalid = reader.forEachWord([&](std::string_view hanzi, std::string_view pinyin) {
+        out << hanzi << ' ' << pinyin << " 0\n";
+    }, progress);
+    if (invalid) {
+        FCITX_WARN() << "Skipped " << invalid << " invalid scel dictionary entries";
+    }
+}
+
+#endif //FCITX5_ANDROID_SCEL_DICT_H
@@ -0,0 +1,204 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef FCITX5_ANDROID_STARTUP_PROFILE_H
+#define FCITX5_ANDROID_STARTUP_PROFILE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Tree of timed phases during startup.
+ *
+ * Phases on the calling thread are opened and closed with begin/end (or Scope), phases timed elsewhere,
+ * eg. on worker threads or inside addon loader, are attached to the innermost open phase with add().
+ * After finish(), phases that startup has been waiting for are marked critical: walking backwards from
+ * the end of a phase, pick the child that ends last, then the child that ends last before it starts, and
+ * so on, then recurse into every picked child. Time not covered by critical children is spent in the
+ * phase itself.
+ */
+class StartupProfile {
+public:
+    struct Phase {
+        std::string name;
+        // index of parent phase, -1 for top level
+        int parent;
+        // relative to start of profile
+        int64_t startMicros;
+        int64_t durationMicros;
+        bool critical;
+
+        int64_t endMicros() const { return startMicros + durationMicros; }
+    };
+
+    /**
+     * A phase timed with now(), without parent
+     */
+    struct Timing {
+        std::string name;
+        int64_t startMicros;
+        int64_t durationMicros;
+    };
+
+    /**
+     * steady clock in microseconds, the same clock for Timing
+     */
+    static int64_t now() {
+        const auto t = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::microseconds>(t).count();
+    }
+
+    class Scope {
+    public:
+        Scope(StartupProfile &profile, std::string name) : profile_(profile) {
+            profile_.begin(std::move(name));
+        }
+
+        ~Scope() { profile_.end(); }
+
+        Scope(const Scope &) = delete;
+
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        StartupProfile &profile_;
+    };
+
+    void reset() {
+        origin_ = now();
+        phases_.clear();
+        open_.clear();
+    }
+
+    void begin(std::string name) {
+        phases_.push_back({std::move(name), current(), now() - origin_, 0, false});
+        open_.push_back(static_cast<int>(phases_.size() - 1));
+    }
+
+    void end() {
+        if (open_.empty()) {
+            return;
+        }
+        auto &phase = phases_[open_.back()];
+        phase.durationMicros = now() - origin_ - phase.startMicros;
+        open_.pop_back();
+    }
+
+    /**
+     * Attach `timings` to the innermost open phase.
+     * @param nested whether `timings` come from one thread and may contain each other,
+     *               eg. an addon being created while creating another; a timing contained in another
+     *               becomes its child
+     */
+    void add(std::vector<Timing> timings, bool nested) {
+        const int parent = current();
+        if (nested) {
+            std::stable_sort(timings.begin(), timings.end(), [](const Timing &a, const Timing &b) {
+                return a.startMicros != b.startMicros ? a.startMicros < b.startMicros
+                                                      : a.durationMicros > b.durationMicros;
+            });
+        }
+        std::vector<int> stack;
+        for (auto &t: timings) {
+            const int64_t start = t.startMicros - origin_;
+            const int64_t end = start + t.durationMicros;
+            while (nested && !stack.empty() && phases_[stack.back()].endMicros() < end) {
+                stack.pop_back();
+            }
+            const int p = stack.empty() ? parent : stack.back();
+            phases_.push_back({std::move(t.name), p, start, t.durationMicros, false});
+            if (nested) {
+                stack.push_back(static_cast<int>(phases_.size() - 1));
+            }
+        }
+    }
+
+    /**
+     * Close all open phases and mark the critical path
+     */
+    void finish() {
+        while (!open_.empty()) {
+            end();
+        }
+        std::vector<std::vector<int>> children(phases_.size() + 1);
+        int64_t total = 0;
+        for (size_t i = 0; i < phases_.size(); i++) {
+            phases_[i].critical = false;
+            // children.back() holds top level phases
+            children[phases_[i].parent < 0 ? phases_.size() : phases_[i].parent].push_back(static_cast<int>(i));
+            total = std::max(total, phases_[i].endMicros());
+        }
+        markCritical(children, children.back(), total);
+    }
+
+    const std::vector<Phase> &phases() const { return phases_; }
+
+    std::vector<const Phase *> criticalPath() const {
+        std::vector<const Phase *> path;
+        for (const auto &phase: phases_) {
+            if (phase.critical) {
+                path.push_back(&phase);
+            }
+        }
+        std::sort(path.begin(), path.end(), [](const Phase *a, const Phase *b) {
+            return a->startMicros < b->startMicros;
+        });
+        return path;
+    }
+
+    /**
+     * Indented tree of phases in milliseconds, critical ones prefixed with '*'
+     */
+    void print(std::ostream &out) const {
+        std::vector<int> depth(phases_.size(), 0);
+        const auto flags = out.flags();
+        out << std::fixed << std::setprecision(3);
+        for (size_t i = 0; i < phases_.size(); i++) {
+            const auto &phase = phases_[i];
+            depth[i] = phase.parent < 0 ? 0 : depth[phase.parent] + 1;
+            out << (phase.critical ? "* " : "  ") << std::string(depth[i] * 2, ' ') << phase.name
+                << " +" << static_cast<double>(phase.startMicros) / 1000
+                << "ms " << static_cast<double>(phase.durationMicros) / 1000 << "ms\n";
+        }
+        out.flags(flags);
+    }
+
+private:
+    int64_t origin_ = now();
+    std::vector<Phase> phases_;
+    std::vector<int> open_;
+
+    int current() const { return open_.empty() ? -1 : open_.back(); }
+
+    void markCritical(const std::vector<std::vector<int>> &children, const std::vector<int> &candidates, int64_t until) {
+        int64_t t = until;
+        while (true) {
+            int picked = -1;
+            for (const int c: candidates) {
+                const auto &phase = phases_[c];
+                if (phase.critical || phase.endMicros() > t) {
+                    continue;
+                }
+                if (picked < 0 || phase.endMicros() > phases_[picked].endMicros()) {
+                    picked = c;
+                }
+            }
+            if (picked < 0) {
+                break;
+            }
+            auto &phase = phases_[picked];
+            phase.critical = true;
+            markCritical(children, children[picked], phase.endMicros());
+            t = phase.startMicros;
+        }
+    }
+};
+
+#endif //FCITX5_ANDROID_STARTUP_PROFILE_H
@@ -0,0 +1,149 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+#ifndef FCITX5_ANDROID_TABLE_DICT_CHECK_H
+#define FCITX5_ANDROID_TABLE_DICT_CHECK_H
+
+#include <cstdint>
+#include <string_view>
+
+enum class TableDictCheckResult {
+    Valid,
+    Invalid,
+    // header is not recognized, need to load the whole dictionary to tell
+    Unknown
+};
+
+/**
+ * Check a libime table dictionary in binary format without decompressing it.
+ *
+ * libime writes a big endian magic and version, followed by zstd compressed content. Here we verify the magic
+ * and version, then walk through headers of zstd frames and blocks, to make sure every block ends within the
+ * file and the last frame ends exactly at end of file. This only touches a few bytes per 128KiB block.
+ */
+class TableDictChecker {
+public:
+    static constexpr uint32_t TableMagic = 0x000fcabe;
+    static constexpr uint32_t TableVersion = 0x2;
+    static constexpr uint32_t UserTableMagic = 0x356fcabe;
+    static constexpr uint32_t UserTableVersion = 0x3;
+
+    TableDictChecker(std::string_view data, bool user) : data_(data), user_(user) {}
+
+    TableDictCheckResult check() {
+        pos_ = 0;
+        uint32_t magic;
+        uint32_t version;
+        if (!readU32BE(magic) || !readU32BE(version)) {
+            return TableDictCheckResult::Invalid;
+        }
+        if (magic != (user_ ? UserTableMagic : TableMagic) ||
+            version != (user_ ? UserTableVersion : TableVersion)) {
+            return TableDictCheckResult::Unknown;
+        }
+        if (pos_ == data_.size()) {
+            return TableDictCheckResult::Invalid;
+        }
+        while (pos_ < data_.size()) {
+            if (!skipFrame()) {
+                return TableDictCheckResult::Invalid;
+            }
+        }
+        return TableDictCheckResult::Valid;
+    }
+
+private:
+    static constexpr uint32_t ZstdMagic = 0xfd2fb528;
+    static constexpr uint32_t ZstdSkippableMagicMask = 0xfffffff0;
+    static constexpr uint32_t ZstdSkippableMagic = 0x184d2a50;
+
+    std::string_view data_;
+    bool user_;
+    size_t pos_ = 0;
+
+    bool skip(uint64_t size) {
+        if (size > data_.size() - pos_) {
+            return false;
+        }
+        pos_ += size;
+        return true;
+    }
+
+    bool readLE(uint32_t &value, size_t size) {
+        if (size > data_.size() - pos_) {
+            return false;
+        }
+        value = 0;
+        for (size_t i = 0; i < size; i++) {
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(data_[pos_ + i])) << (8 * i);
+        }
+        pos_ += size;
+        return true;
+    }
+
+    bool readU32BE(uint32_t &value) {
+        if (!readLE(value, 4)) {
+            return false;
+        }
+        value = (value >> 24) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24);
+        return true;
+    }
+
+    bool skipFrame() {
+        uint32_t magic;
+        if (!readLE(magic, 4)) {
+            return false;
+        }
+        if ((magic & ZstdSkippableMagicMask) == ZstdSkippableMagic) {
+            uint32_t size;
+            return readLE(size, 4) && skip(size);
+        }
+        if (magic != ZstdMagic) {
+            return false;
+        }
+        uint32_t descriptor;
+        if (!readLE(descriptor, 1)) {
+            return false;
+        }
+        const uint32_t contentSizeFlag = descriptor >> 6;
+        const bool singleSegment = descriptor & 0x20;
+        const bool reserved = descriptor & 0x08;
+        const bool checksum = descriptor & 0x04;
+        const uint32_t dictIdFlag = descriptor & 0x03;
+        if (reserved) {
+            return false;
+        }
+        static constexpr size_t dictIdSizes[] = {0, 1, 2, 4};
+        static constexpr size_t contentSizeSizes[] = {0, 2, 4, 8};
+        size_t headerSize = (singleSegment ? 0 : 1) + dictIdSizes[dictIdFlag] +
+                            (contentSizeFlag == 0 && singleSegment ? 1 : contentSizeSizes[contentSizeFlag]);
+        if (!skip(headerSize)) {
+            return false;
+        }
+        bool last = false;
+        while (!last) {
+            uint32_t blockHeader;
+            if (!readLE(blockHeader, 3)) {
+                return false;
+            }
+            last = blockHeader & 1;
+            const uint32_t type = (blockHeader >> 1) & 0x3;
+            const uint32_t size = blockHeader >> 3;
+            switch (type) {
+                case 0: // raw
+                case 2: // compressed
+                    if (!skip(size)) return false;
+                    break;
+                case 1: // rle
+                    if (!skip(1)) return false;
+                    break;
+                default: // reserved
+                    return false;
+            }
+        }
+        return !checksum || skip(4);
+    }
+};
+
+#endif //FCITX5_ANDROID_TABLE_DICT_CHECK_H
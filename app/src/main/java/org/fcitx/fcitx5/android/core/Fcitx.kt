@@ -72,18 +72,33 @@ class Fcitx(private val context: Context) : FcitxAPI, FcitxLifecycleOwner {
 
     override suspend fun save() = withFcitxContext { saveFcitxState() }
     override suspend fun reloadConfig() = withFcitxContext { reloadFcitxConfig() }
+    override suspend fun reloadChangedConfig() = withFcitxContext {
+        reloadChangedFcitxConfig()?.toList() ?: emptyList()
+    }
+
+    override suspend fun startupProfile() = withFcitxContext { getFcitxStartupProfile().toList() }
+
+    override fun keyLatency() = getKeyLatencyHistograms().toList()
 
-    override suspend fun sendKey(key: String, states: UInt, up: Boolean, timestamp: Int) =
-        withFcitxContext { sendKeyToFcitxString(key, states.toInt(), up, timestamp) }
+    override fun resetKeyLatency() = resetKeyLatencyHistograms()
 
-    override suspend fun sendKey(c: Char, states: UInt, up: Boolean, timestamp: Int) =
-        withFcitxContext { sendKeyToFcitxChar(c, states.toInt(), up, timestamp) }
+    override suspend fun sendKey(key: String, states: UInt, up: Boolean, timestamp: Int, eventTime: Long) =
+        withFcitxContext { sendKeyToFcitxString(key, states.toInt(), up, timestamp, eventTime) }
 
-    override suspend fun sendKey(sym: Int, states: UInt, up: Boolean, timestamp: Int) =
-        withFcitxContext { sendKeySymToFcitx(sym, states.toInt(), up, timestamp) }
+    override suspend fun sendKey(c: Char, states: UInt, up: Boolean, timestamp: Int, eventTime: Long) =
+        withFcitxContext { sendKeyToFcitxChar(c, states.toInt(), up, timestamp, eventTime) }
 
-    override suspend fun sendKey(sym: KeySym, states: KeyStates, up: Boolean, timestamp: Int) =
-        withFcitxContext { sendKeySymToFcitx(sym.sym, states.toInt(), up, timestamp) }
+    override suspend fun sendKey(sym: Int, states: UInt, up: Boolean, timestamp: Int, eventTime: Long) =
+        withFcitxContext { sendKeySymToFcitx(sym, states.toInt(), up, timestamp, eventTime) }
+
+    override suspend fun sendKey(sym: KeySym, states: KeyStates, up: Boolean, timestamp: Int, eventTime: Long) =
+        withFcitxContext { sendKeySymToFcitx(sym.sym, states.toInt(), up, timestamp, eventTime) }
+
+    override suspend fun sendKeys(batch: KeyEventBatch) {
+        if (batch.isEmpty()) return
+        val keys = batch.toIntArray()
+        withFcitxContext { sendKeysToFcitx(keys) }
+    }
 
     override suspend fun select(idx: Int): Boolean = withFcitxContext { selectCandidate(idx) }
     override suspend fun forget(idx: Int): Boolean = withFcitxContext { forgetCandidate(idx) }
@@ -112,7 +127,8 @@ class Fcitx(private val context: Context) : FcitxAPI, FcitxLifecycleOwner {
     }
 
     override suspend fun setGlobalConfig(config: RawConfig) = withFcitxContext {
-        setFcitxGlobalConfig(config)
+        val (nodes, pool) = config.flatten()
+        setFcitxGlobalConfig(nodes, pool)
     }
 
     override suspend fun getAddonConfig(addon: String) = withFcitxContext {
@@ -120,7 +136,8 @@ class Fcitx(private val context: Context) : FcitxAPI, FcitxLifecycleOwner {
     }
 
     override suspend fun setAddonConfig(addon: String, config: RawConfig) = withFcitxContext {
-        setFcitxAddonConfig(addon, config)
+        val (nodes, pool) = config.flatten()
+        setFcitxAddonConfig(addon, nodes, pool)
     }
 
     override suspend fun getAddonSubConfig(addon: String, path: String) = withFcitxContext {
@@ -128,14 +145,18 @@ class Fcitx(private val context: Context) : FcitxAPI, FcitxLifecycleOwner {
     }
 
     override suspend fun setAddonSubConfig(addon: String, path: String, config: RawConfig) =
-        withFcitxContext { setFcitxAddonSubConfig(addon, path, config) }
+        withFcitxContext {
+            val (nodes, pool) = config.flatten()
+            setFcitxAddonSubConfig(addon, path, nodes, pool)
+        }
 
     override suspend fun getImConfig(key: String) = withFcitxContext {
         getFcitxInputMethodConfig(key) ?: RawConfig()
     }
 
     override suspend fun setImConfig(key: String, config: RawConfig) = withFcitxContext {
-        setFcitxInputMethodConfig(key, config)
+        val (nodes, pool) = config.flatten()
+        setFcitxInputMethodConfig(key, nodes, pool)
     }
 
     override suspend fun addons() = withFcitxContext { getFcitxAddons() ?: emptyArray() }
@@ -155,6 +176,9 @@ class Fcitx(private val context: Context) : FcitxAPI, FcitxLifecycleOwner {
     override suspend fun setCapFlags(flags: CapabilityFlags) =
         withFcitxContext { setCapabilityFlags(flags.toLong()) }
 
+    override suspend fun setSurroundingText(text: String, cursor: Int, anchor: Int) =
+        withFcitxContext { setFcitxSurroundingText(text, cursor, anchor) }
+
     override suspend fun statusArea(): Array<Action> =
         withFcitxContext { getFcitxStatusAreaActions() ?: emptyArray() }
 
@@ -211,9 +235,20 @@ class Fcitx(private val context: Context) : FcitxAPI, FcitxLifecycleOwner {
             extCache: String,
             extDomains: Array<String>,
             libraryNames: Array<String>,
-            libraryDependencies: Array<Array<String>>
+            libraryDependencies: Array<Array<String>>,
+            deferAddons: Boolean
         )
 
+        @JvmStatic
+        external fun softRestartFcitx(
+            appData: String,
+            appLib: String,
+            extDomains: Array<String>,
+            libraryNames: Array<String>,
+            libraryDependencies: Array<Array<String>>,
+            dataChanged: Boolean
+        ): Long
+
         @JvmStatic
         external fun getFcitxTranslation(domain: String, str: String): String
 
@@ -227,13 +262,28 @@ class Fcitx(private val context: Context) : FcitxAPI, FcitxLifecycleOwner {
         external fun reloadFcitxConfig()
 
         @JvmStatic
-        external fun sendKeyToFcitxString(key: String, state: Int, up: Boolean, timestamp: Int)
+        external fun reloadChangedFcitxConfig(): Array<ConfigReloadEntry>?
+
+        @JvmStatic
+        external fun getFcitxStartupProfile(): Array<StartupPhase>
+
+        @JvmStatic
+        external fun getKeyLatencyHistograms(): Array<KeyLatencyHistogram>
 
         @JvmStatic
-        external fun sendKeyToFcitxChar(c: Char, state: Int, up: Boolean, timestamp: Int)
+        external fun resetKeyLatencyHistograms()
 
         @JvmStatic
-        external fun sendKeySymToFcitx(sym: Int, state: Int, up: Boolean, timestamp: Int)
+        external fun sendKeyToFcitxString(key: String, state: Int, up: Boolean, timestamp: Int, eventTime: Long)
+
+        @JvmStatic
+        external fun sendKeyToFcitxChar(c: Char, state: Int, up: Boolean, timestamp: Int, eventTime: Long)
+
+        @JvmStatic
+        external fun sendKeySymToFcitx(sym: Int, state: Int, up: Boolean, timestamp: Int, eventTime: Long)
+
+        @JvmStatic
+        external fun sendKeysToFcitx(keys: IntArray)
 
         @JvmStatic
         external fun selectCandidate(idx: Int): Boolean
@@ -284,16 +334,16 @@ class Fcitx(private val context: Context) : FcitxAPI, FcitxLifecycleOwner {
         external fun getFcitxInputMethodConfig(im: String): RawConfig?
 
         @JvmStatic
-        external fun setFcitxGlobalConfig(config: RawConfig)
+        external fun setFcitxGlobalConfig(nodes: IntArray, pool: ByteArray)
 
         @JvmStatic
-        external fun setFcitxAddonConfig(addon: String, config: RawConfig)
+        external fun setFcitxAddonConfig(addon: String, nodes: IntArray, pool: ByteArray)
 
         @JvmStatic
-        external fun setFcitxAddonSubConfig(addon: String, path: String, config: RawConfig)
+        external fun setFcitxAddonSubConfig(addon: String, path: String, nodes: IntArray, pool: ByteArray)
 
         @JvmStatic
-        external fun setFcitxInputMethodConfig(im: String, config: RawConfig)
+        external fun setFcitxInputMethodConfig(im: String, nodes: IntArray, pool: ByteArray)
 
         @JvmStatic
         external fun getFcitxAddons(): Array<AddonInfo>?
@@ -322,6 +372,9 @@ class Fcitx(private val context: Context) : FcitxAPI, FcitxLifecycleOwner {
         @JvmStatic
         external fun setCapabilityFlags(flags: Long)
 
+        @JvmStatic
+        external fun setFcitxSurroundingText(text: String, cursor: Int, anchor: Int)
+
         @JvmStatic
         external fun getFcitxStatusAreaActions(): Array<Action>?
 
@@ -378,17 +431,19 @@ class Fcitx(private val context: Context) : FcitxAPI, FcitxLifecycleOwner {
 
     }
 
-    private val dispatcher = FcitxDispatcher(object : FcitxDispatcher.FcitxController {
-        override fun nativeStartup() {
-            DataManager.sync()
-            val locale = Locales.fcitxLocale
-            val dataDir = DataManager.dataDir.absolutePath
-            val plugins = DataManager.getLoadedPlugins()
-            val nativeLibDir = StringBuilder(context.applicationInfo.nativeLibraryDir)
-            val extDomains = arrayListOf<String>()
-            val libraryNames = arrayListOf<String>()
-            val libraryDependency = arrayListOf<Array<String>>()
-            plugins.forEach {
+    /**
+     * Native libraries and gettext domains of app and loaded plugins
+     */
+    private class PluginLibraries(context: Context) {
+        val nativeLibDir = StringBuilder(context.applicationInfo.nativeLibraryDir)
+        val extDomains = arrayListOf<String>()
+        val libraryNames = arrayListOf<String>()
+        val libraryDependency = arrayListOf<Array<String>>()
+        val pluginVersions = mutableMapOf<String, String>()
+
+        init {
+            DataManager.getLoadedPlugins().forEach {
+                pluginVersions[it.packageName] = it.versionName
                 nativeLibDir.append(':')
                 nativeLibDir.append(it.nativeLibraryDir)
                 it.domain?.let { d ->
@@ -399,25 +454,68 @@ class Fcitx(private val context: Context) : FcitxAPI, FcitxLifecycleOwner {
                     libraryDependency.add(dep.toTypedArray())
                 }
             }
+        }
+    }
+
+    /**
+     * package name -> version name of plugins loaded by fcitx, libraries of them stay loaded
+     */
+    private var loadedPluginVersions = emptyMap<String, String>()
+
+    /**
+     * Load addons from newly installed plugins, and addons that have been enabled,
+     * without stopping fcitx.
+     * @return time spent in microseconds, or -1 if fcitx needs a cold restart
+     */
+    suspend fun softRestart(): Long = withFcitxContext {
+        // check before data of removed or updated plugins is touched by sync
+        val (detected, _) = DataManager.detectPlugins()
+        val versions = detected.associate { it.packageName to it.versionName }
+        if (loadedPluginVersions.any { (pkg, version) -> versions[pkg] != version }) {
+            Timber.i("Plugins have been removed or updated, need a cold restart")
+            return@withFcitxContext -1L
+        }
+        val dataChanged = DataManager.sync()
+        val libs = PluginLibraries(context)
+        softRestartFcitx(
+            DataManager.dataDir.absolutePath,
+            libs.nativeLibDir.toString(),
+            libs.extDomains.toTypedArray(),
+            libs.libraryNames.toTypedArray(),
+            libs.libraryDependency.toTypedArray(),
+            dataChanged
+        ).also {
+            if (it >= 0) loadedPluginVersions = libs.pluginVersions
+        }
+    }
+
+    private val dispatcher = FcitxDispatcher(object : FcitxDispatcher.FcitxController {
+        override fun nativeStartup() {
+            DataManager.sync()
+            val locale = Locales.fcitxLocale
+            val dataDir = DataManager.dataDir.absolutePath
+            val libs = PluginLibraries(context)
+            loadedPluginVersions = libs.pluginVersions
             Timber.d(
                 """
                Starting fcitx with:
                locale=$locale
                dataDir=$dataDir
-               nativeLibDir=$nativeLibDir
-               extDomains=${extDomains.joinToString()}
+               nativeLibDir=${libs.nativeLibDir}
+               extDomains=${libs.extDomains.joinToString()}
             """.trimIndent()
             )
             with(FcitxApplication.getInstance().directBootAwareContext) {
                 startupFcitx(
                     locale,
                     dataDir,
-                    nativeLibDir.toString(),
+                    libs.nativeLibDir.toString(),
                     (getExternalFilesDir(null) ?: filesDir).absolutePath,
                     (externalCacheDir ?: cacheDir).absolutePath,
-                    extDomains.toTypedArray(),
-                    libraryNames.toTypedArray(),
-                    libraryDependency.toTypedArray()
+                    libs.extDomains.toTypedArray(),
+                    libs.libraryNames.toTypedArray(),
+                    libs.libraryDependency.toTypedArray(),
+                    AppPrefs.getInstance().internal.deferAddons.getValue()
                 )
             }
             if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.UPSIDE_DOWN_CAKE) {
@@ -4,6 +4,7 @@
  */
 package org.fcitx.fcitx5.android.core
 
+import android.os.SystemClock
 import kotlinx.coroutines.flow.SharedFlow
 
 /**
@@ -39,17 +40,72 @@ interface FcitxAPI {
 
     fun translate(str: String, domain: String = "fcitx5"): String
 
+    /**
+     * Latency histograms of key presses since last [resetKeyLatency], for each input method and stage.
+     * Can be called on any thread, no matter whether fcitx is running.
+     */
+    fun keyLatency(): List<KeyLatencyHistogram>
+
+    fun resetKeyLatency()
+
     suspend fun save()
 
     suspend fun reloadConfig()
 
-    suspend fun sendKey(key: String, states: UInt = 0u, up: Boolean = false, timestamp: Int = -1)
+    /**
+     * Reload only global config, input method list, or addons, whose files in user config or data
+     * directory have changed since last reload.
+     * @return what has been reloaded, in order
+     */
+    suspend fun reloadChangedConfig(): List<ConfigReloadEntry>
 
-    suspend fun sendKey(c: Char, states: UInt = 0u, up: Boolean = false, timestamp: Int = -1)
+    /**
+     * Timed phases of last startup, including dlopen of every library and creation of every addon
+     * loaded during startup. Parents always come before their children.
+     */
+    suspend fun startupProfile(): List<StartupPhase>
 
-    suspend fun sendKey(sym: Int, states: UInt = 0u, up: Boolean = false, timestamp: Int = -1)
+    /**
+     * @param eventTime [SystemClock.uptimeMillis] when the key was received, to measure dispatch latency,
+     *                  for virtual keyboard keys the time the key action fired; -1 when there is no such time
+     */
+    suspend fun sendKey(
+        key: String,
+        states: UInt = 0u,
+        up: Boolean = false,
+        timestamp: Int = -1,
+        eventTime: Long = -1L
+    )
+
+    suspend fun sendKey(
+        c: Char,
+        states: UInt = 0u,
+        up: Boolean = false,
+        timestamp: Int = -1,
+        eventTime: Long = -1L
+    )
+
+    suspend fun sendKey(
+        sym: Int,
+        states: UInt = 0u,
+        up: Boolean = false,
+        timestamp: Int = -1,
+        eventTime: Long = -1L
+    )
+
+    suspend fun sendKey(
+        sym: KeySym,
+        states: KeyStates,
+        up: Boolean = false,
+        timestamp: Int = -1,
+        eventTime: Long = -1L
+    )
 
-    suspend fun sendKey(sym: KeySym, states: KeyStates, up: Boolean = false, timestamp: Int = -1)
+    /**
+     * Send all key events in [batch] within one event loop iteration.
+     * Input panel updates are coalesced, so that only the state after the last key is emitted.
+     */
+    suspend fun sendKeys(batch: KeyEventBatch)
 
     suspend fun select(idx: Int): Boolean
     suspend fun forget(idx: Int): Boolean
@@ -95,6 +151,12 @@ interface FcitxAPI {
     suspend fun deactivate(uid: Int)
     suspend fun setCapFlags(flags: CapabilityFlags)
 
+    /**
+     * @param cursor cursor position in code points
+     * @param anchor selection anchor in code points
+     */
+    suspend fun setSurroundingText(text: String, cursor: Int, anchor: Int = cursor)
+
     suspend fun statusArea(): Array<Action>
 
     suspend fun activateAction(id: Int)
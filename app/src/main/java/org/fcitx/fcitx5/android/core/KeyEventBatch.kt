@@ -0,0 +1,49 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+package org.fcitx.fcitx5.android.core
+
+/**
+ * Key events to be sent by [FcitxAPI.sendKeys] in one JNI call.
+ * Every event is stored as 4 ints: sym, states, up and timestamp.
+ */
+class KeyEventBatch(capacity: Int = 8) {
+
+    private var data = IntArray(capacity * FIELDS)
+
+    var size = 0
+        private set
+
+    fun isEmpty() = size == 0
+
+    fun add(
+        sym: KeySym,
+        states: KeyStates = KeyStates(),
+        up: Boolean = false,
+        timestamp: Int = -1
+    ): KeyEventBatch {
+        val offset = size * FIELDS
+        if (offset + FIELDS > data.size) {
+            data = data.copyOf(maxOf(data.size * 2, offset + FIELDS))
+        }
+        data[offset] = sym.sym
+        data[offset + 1] = states.toInt()
+        data[offset + 2] = if (up) 1 else 0
+        data[offset + 3] = timestamp
+        size++
+        return this
+    }
+
+    /**
+     * add both press and release of [sym]
+     */
+    fun tap(sym: KeySym, states: KeyStates = KeyStates(), timestamp: Int = -1) =
+        add(sym, states, false, timestamp).add(sym, states, true, timestamp)
+
+    fun toIntArray(): IntArray = data.copyOf(size * FIELDS)
+
+    companion object {
+        private const val FIELDS = 4
+    }
+}
@@ -0,0 +1,16 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ * SPDX-FileCopyrightText: Copyright 2021-2023 Fcitx5 for Android Contributors
+ */
+package org.fcitx.fcitx5.android.core
+
+/**
+ * Progress of a long-running native operation, called on the thread that started it.
+ */
+fun interface ProgressListener {
+    /**
+     * @param processed amount of work done, in the same unit as [total]
+     * @return false to cancel the operation
+     */
+    fun onProgress(processed: Long, total: Long): Boolean
+}
@@ -6,6 +6,7 @@ package org.fcitx.fcitx5.android.core
 
 import android.os.Parcelable
 import kotlinx.parcelize.Parcelize
+import java.io.ByteArrayOutputStream
 
 data class InputMethodSubMode(val name: String, val label: String, val icon: String) {
     constructor() : this("", "", "")
@@ -106,6 +107,86 @@ data class RawConfig(
         }
     }
 
+    /**
+     * Flatten the tree into node table and string pool, in the layout accepted by native side.
+     * See [fromFlat]. Value of a node with sub items is written as absent, because it is ignored.
+     */
+    fun flatten(): Pair<IntArray, ByteArray> {
+        var nodes = IntArray(FLAT_NODE_SIZE * 16)
+        var count = 0
+        val pool = ByteArrayOutputStream()
+        fun putString(offset: Int, s: String) {
+            if (s.isEmpty()) return
+            val bytes = s.toByteArray(Charsets.UTF_8)
+            nodes[offset] = pool.size()
+            nodes[offset + 1] = bytes.size
+            pool.write(bytes)
+        }
+
+        fun visit(item: RawConfig, parent: Int) {
+            if ((count + 1) * FLAT_NODE_SIZE > nodes.size) {
+                nodes = nodes.copyOf(nodes.size * 2)
+            }
+            val index = count++
+            val base = index * FLAT_NODE_SIZE
+            nodes[base] = parent
+            putString(base + 1, item.name)
+            putString(base + 3, item.comment)
+            val items = item.subItems
+            if (items == null) {
+                putString(base + 5, item.value)
+            } else {
+                nodes[base + 6] = -1
+                items.forEach { visit(it, index) }
+            }
+        }
+        visit(this, -1)
+        return nodes.copyOf(count * FLAT_NODE_SIZE) to pool.toByteArray()
+    }
+
+    companion object {
+        private const val FLAT_NODE_SIZE = 7
+
+        /**
+         * Build tree from the flattened form produced on native side (flat-config.h): every node takes
+         * [FLAT_NODE_SIZE] ints in [nodes], which are parent index, then offset and length of name, comment
+         * and value in UTF-8 [pool]. Nodes are in pre-order, so a parent always comes before its children.
+         */
+        @JvmStatic
+        fun fromFlat(nodes: IntArray, pool: ByteArray): RawConfig {
+            val count = nodes.size / FLAT_NODE_SIZE
+            val childCount = IntArray(count)
+            for (i in 1 until count) {
+                childCount[nodes[i * FLAT_NODE_SIZE]]++
+            }
+            fun string(offset: Int): String {
+                val length = nodes[offset + 1]
+                return if (length <= 0) "" else String(pool, nodes[offset], length, Charsets.UTF_8)
+            }
+
+            val items = arrayOfNulls<RawConfig>(count)
+            val children = arrayOfNulls<Array<RawConfig?>>(count)
+            val filled = IntArray(count)
+            for (i in 0 until count) {
+                val base = i * FLAT_NODE_SIZE
+                val item = RawConfig(string(base + 1), string(base + 3), string(base + 5), null)
+                items[i] = item
+                if (childCount[i] > 0) {
+                    children[i] = arrayOfNulls(childCount[i])
+                }
+                val parent = nodes[base]
+                if (parent >= 0) {
+                    children[parent]!![filled[parent]++] = item
+                }
+            }
+            for (i in 0 until count) {
+                @Suppress("UNCHECKED_CAST")
+                items[i]!!.subItems = children[i] as Array<RawConfig>?
+            }
+            return items.firstOrNull() ?: RawConfig()
+        }
+    }
+
     /**
      * generated by Android Studio
      */
@@ -138,6 +219,59 @@ data class RawConfig(
     }
 }
 
+/**
+ * @param target "global", "refresh", or unique name of addon
+ */
+data class ConfigReloadEntry(val target: String, val durationMicros: Long)
+
+/**
+ * @param parent index of parent phase, -1 for top level
+ * @param startMicros relative to the beginning of startup
+ * @param critical whether startup has been waiting for this phase
+ */
+data class StartupPhase(
+    val name: String,
+    val parent: Int,
+    val startMicros: Long,
+    val durationMicros: Long,
+    val critical: Boolean
+)
+
+/**
+ * Latency of key presses in one input method, bucketed like HdrHistogram.
+ * @param stage "dispatch" (Android event to JNI), "engine" (JNI to key event handled),
+ *              or "output" (JNI to first commit, preedit or input panel update)
+ * @param bucketUpperMicros inclusive upper bound of every non-empty bucket, ascending
+ */
+class KeyLatencyHistogram(
+    val inputMethod: String,
+    val stage: String,
+    val count: Long,
+    val sumMicros: Long,
+    val maxMicros: Long,
+    val bucketUpperMicros: LongArray,
+    val bucketCounts: LongArray
+) {
+    val meanMicros get() = if (count == 0L) 0L else sumMicros / count
+
+    /**
+     * @param percentile in 0.0..100.0
+     * @return upper bound of the bucket containing this percentile
+     */
+    fun valueAt(percentile: Double): Long {
+        val target = (count * percentile / 100.0).coerceAtLeast(1.0)
+        var seen = 0L
+        bucketCounts.forEachIndexed { i, c ->
+            seen += c
+            if (seen >= target) return minOf(bucketUpperMicros[i], maxMicros)
+        }
+        return maxMicros
+    }
+
+    override fun toString() =
+        "$inputMethod/$stage: n=$count mean=${meanMicros}us p50=${valueAt(50.0)}us p99=${valueAt(99.0)}us max=${maxMicros}us"
+}
+
 enum class AddonCategory {
     InputMethod, Frontend, Loader, Module, UI;
 
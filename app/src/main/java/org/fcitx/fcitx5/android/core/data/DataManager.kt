@@ -193,7 +193,10 @@ object DataManager {
         return toLoad to preloadFailed
     }
 
-    fun sync() = lock.withLock {
+    /**
+     * @return whether any data file has been created, updated or removed
+     */
+    fun sync(): Boolean = lock.withLock {
         synced = false
         loadedPlugins.clear()
         failedPlugins.clear()
@@ -250,7 +253,8 @@ object DataManager {
 
         // Compute the difference of the created one and the old one
         // Run actions to migrate to the new hierarchy
-        DataHierarchy.diff(oldDescriptor, newHierarchy).sortedByDescending { it.ordinal }.forEach {
+        val actions = DataHierarchy.diff(oldDescriptor, newHierarchy).sortedByDescending { it.ordinal }
+        actions.forEach {
             Timber.d("Action: $it")
             when (it) {
                 is FileAction.CreateFile -> {
@@ -295,6 +299,7 @@ object DataManager {
         }
         synced = true
         Timber.d("Synced")
+        actions.isNotEmpty()
     }
 
     private fun removePath(path: String) =
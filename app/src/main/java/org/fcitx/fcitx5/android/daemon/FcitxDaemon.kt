@@ -131,6 +131,20 @@ object FcitxDaemon {
         }
     }
 
+    /**
+     * Load newly installed plugins in place, fall back to [restartFcitx] if fcitx cannot do so
+     */
+    fun reloadPlugins() {
+        FcitxApplication.getInstance().coroutineScope.launch {
+            val duration = if (realFcitx.isReady) realFcitx.softRestart() else -1L
+            if (duration < 0) {
+                restartFcitx()
+            } else {
+                Timber.i("Soft restarted fcitx in ${duration}us")
+            }
+        }
+    }
+
     /**
      * Stop fcitx instance regardless of connected clients.
      * Should only be used before importing user configuration files,
@@ -7,9 +7,45 @@ package org.fcitx.fcitx5.android.data.pinyin
 import org.fcitx.fcitx5.android.data.pinyin.customphrase.PinyinCustomPhrase
 
 object CustomPhraseManager {
+    /**
+     * Sync the native store with the text file read by pinyin addon, and compact its edit log if it
+     * has grown large. Ids obtained before are invalidated. [count] and [get] read the store as of
+     * last call to this, so that phrases do not shift while paging.
+     */
     @JvmStatic
-    external fun load(): Array<PinyinCustomPhrase>?
+    external fun open(): Boolean
 
+    /**
+     * Number of phrases whose key starts with [keyPrefix] and value contains [valueSubstring].
+     * Empty strings match every phrase.
+     */
     @JvmStatic
-    external fun save(items: Array<PinyinCustomPhrase>)
+    external fun count(keyPrefix: String = "", valueSubstring: String = ""): Int
+
+    /**
+     * At most [limit] phrases from [offset] among those matching [keyPrefix] and [valueSubstring],
+     * in base file order followed by phrases added later. Filtered results are cached on native side, so paging through
+     * one query only filters once.
+     */
+    @JvmStatic
+    external fun get(
+        offset: Int,
+        limit: Int,
+        keyPrefix: String = "",
+        valueSubstring: String = ""
+    ): Array<PinyinCustomPhrase>?
+
+    /**
+     * Apply edits to the native store and its edit log, then bring the text file read by pinyin addon
+     * up to date. Phrases are addressed by [PinyinCustomPhrase.id] obtained from [get], which stay
+     * valid until next [open]. The whole batch holds the store lock, so [open] cannot renumber phrases
+     * in the middle of it.
+     * @return ids of [added] phrases, -1 for those that failed, or null on failure
+     */
+    @JvmStatic
+    external fun edit(
+        removed: IntArray,
+        updated: Array<PinyinCustomPhrase>,
+        added: Array<PinyinCustomPhrase>
+    ): IntArray?
 }
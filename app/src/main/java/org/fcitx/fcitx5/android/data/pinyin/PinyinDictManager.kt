@@ -5,6 +5,7 @@
 package org.fcitx.fcitx5.android.data.pinyin
 
 import org.fcitx.fcitx5.android.R
+import org.fcitx.fcitx5.android.core.ProgressListener
 import org.fcitx.fcitx5.android.core.data.DataManager
 import org.fcitx.fcitx5.android.data.pinyin.dict.BuiltinDictionary
 import org.fcitx.fcitx5.android.data.pinyin.dict.LibIMEDictionary
@@ -13,7 +14,6 @@ import org.fcitx.fcitx5.android.utils.appContext
 import org.fcitx.fcitx5.android.utils.errorArg
 import timber.log.Timber
 import java.io.File
-import java.io.IOException
 import java.io.InputStream
 
 object PinyinDictManager {
@@ -26,10 +26,6 @@ object PinyinDictManager {
         DataManager.dataDir, "usr/share/fcitx5/pinyin/dictionaries"
     )
 
-    private val nativeDir = File(appContext.applicationInfo.nativeLibraryDir)
-
-    private val scel2org5 by lazy { File(nativeDir, scel2org5Name) }
-
     fun listDictionaries(): List<PinyinDictionary> =
         (builtinPinyinDictDir.listFiles()?.mapNotNull {
             it.takeIf { it.extension == PinyinDictionary.Type.LibIME.ext }
@@ -40,7 +36,10 @@ object PinyinDictManager {
                     ?.mapNotNull { PinyinDictionary.new(it)?.takeIf { it is LibIMEDictionary } }
                     ?.toList() ?: listOf())
 
-    fun importFromFile(file: File): Result<LibIMEDictionary> = runCatching {
+    fun importFromFile(
+        file: File,
+        listener: ProgressListener? = null
+    ): Result<LibIMEDictionary> = runCatching {
         val raw =
             PinyinDictionary.new(file) ?: errorArg(R.string.exception_dict_filename, file.path)
         // convert to libime format in dictionaries dir
@@ -49,39 +48,113 @@ object PinyinDictManager {
             File(
                 pinyinDicDir,
                 file.nameWithoutExtension + ".${PinyinDictionary.Type.LibIME.ext}"
-            )
+            ),
+            listener
         )
         Timber.d("Converted $raw to $new")
         new
     }
 
-    fun importFromInputStream(stream: InputStream, name: String): Result<LibIMEDictionary> {
+    fun importFromInputStream(
+        stream: InputStream,
+        name: String,
+        listener: ProgressListener? = null
+    ): Result<LibIMEDictionary> {
         val tempFile = File(appContext.cacheDir, name)
         tempFile.outputStream().use {
             stream.copyTo(it)
         }
-        val new = importFromFile(tempFile)
+        val new = importFromFile(tempFile, listener)
         tempFile.delete()
         return new
     }
 
-    fun sougouDictConv(src: String, dest: String) {
-        val process = Runtime.getRuntime()
-            .exec(
-                arrayOf(scel2org5.absolutePath, "-o", dest, src),
-                arrayOf("LD_LIBRARY_PATH=${nativeDir.absolutePath}")
-            )
-        process.waitFor()
-        if (process.exitValue() != 0) {
-            throw IOException(process.errorStream.bufferedReader().readText())
+    /**
+     * Convert all [files] to libime format in dictionaries dir with a single native call.
+     * @param mergedName merge all files into one dictionary with this name,
+     * or keep one dictionary per file (with original file name) if null,
+     * in which case no two of [files] may have the same name without extension
+     */
+    fun importFromFiles(
+        files: List<File>,
+        mergedName: String? = null,
+        listener: ProgressListener? = null
+    ): Result<List<LibIMEDictionary>> = runCatching {
+        files.forEach {
+            PinyinDictionary.Type.fromFileName(it.name)
+                ?: errorArg(R.string.exception_dict_filename, it.path)
+        }
+        if (mergedName == null) {
+            // foo.txt and foo.scel would both be converted to foo.dict
+            files.groupBy { it.nameWithoutExtension }.values.firstOrNull { it.size > 1 }?.let {
+                errorArg(R.string.exception_dict_name_clash, it.joinToString { f -> f.name })
+            }
+        }
+        val dests = (mergedName?.let { listOf(it) } ?: files.map { it.nameWithoutExtension })
+            .map { File(pinyinDicDir, "$it.${PinyinDictionary.Type.LibIME.ext}") }
+        pinyinDictBatchConv(
+            files.map { it.absolutePath }.toTypedArray(),
+            dests.map { it.absolutePath }.toTypedArray(),
+            listener
+        )
+        dests.map { LibIMEDictionary(it) }.also {
+            Timber.d("Converted $files to $it")
         }
     }
 
+    /**
+     * @param listener receives progress of [MODE_TXT_TO_BIN] conversion in bytes of [src],
+     * and may cancel it by returning false
+     */
+    @JvmStatic
+    external fun pinyinDictConv(
+        src: String,
+        dest: String,
+        mode: Boolean,
+        listener: ProgressListener?
+    )
+
+    /**
+     * Convert pinyin dictionaries in any supported format to libime binary format
+     * @param dests a single merged destination, or one destination for each of [srcs]
+     * @param listener receives progress in bytes of all [srcs], and may cancel it by returning false
+     */
     @JvmStatic
-    external fun pinyinDictConv(src: String, dest: String, mode: Boolean)
+    external fun pinyinDictBatchConv(
+        srcs: Array<String>,
+        dests: Array<String>,
+        listener: ProgressListener?
+    )
+
+    /**
+     * Write entries added, removed or re-weighted from [base] to [result] into [diff].
+     * Both dictionaries are in libime binary format, and the diff is deterministic.
+     * @return number of changed entries
+     */
+    @JvmStatic
+    external fun pinyinDictDiff(base: String, result: String, diff: String): Int
+
+    /**
+     * Apply [diff] produced by [pinyinDictDiff] to [base], and save the result to [dest].
+     * Throws if [base] is not the dictionary the diff was made from.
+     */
+    @JvmStatic
+    external fun pinyinDictPatch(base: String, diff: String, dest: String)
+
+    /**
+     * Decode Sogou cell dictionary (.scel) in process
+     * @param text write libime text format if true, otherwise libime binary format
+     * @param listener receives progress in bytes of [src], and may cancel it by returning false
+     */
+    @JvmStatic
+    external fun sougouDictConv(
+        src: String,
+        dest: String,
+        text: Boolean,
+        listener: ProgressListener?
+    )
 
     const val MODE_BIN_TO_TXT = true
     const val MODE_TXT_TO_BIN = false
-    private const val scel2org5Name = "libscel2org5.so"
 
 }
\ No newline at end of file
@@ -7,10 +7,14 @@ package org.fcitx.fcitx5.android.data.pinyin.customphrase
 import org.fcitx.fcitx5.android.core.FcitxUtils
 import kotlin.math.absoluteValue
 
+/**
+ * @param id id in native custom phrase store, or -1 if it has not been added yet
+ */
 data class PinyinCustomPhrase(
     val key: String,
     val order: Int,
-    val value: String
+    val value: String,
+    val id: Int = -1
 ) {
     val enabled: Boolean get() = order > 0
 
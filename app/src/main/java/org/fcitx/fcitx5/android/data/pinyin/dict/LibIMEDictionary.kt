@@ -5,6 +5,7 @@
 package org.fcitx.fcitx5.android.data.pinyin.dict
 
 import org.fcitx.fcitx5.android.R
+import org.fcitx.fcitx5.android.core.ProgressListener
 import org.fcitx.fcitx5.android.data.pinyin.PinyinDictManager
 import org.fcitx.fcitx5.android.utils.errorArg
 import java.io.File
@@ -59,12 +60,13 @@ class LibIMEDictionary(file: File) : PinyinDictionary() {
         PinyinDictManager.pinyinDictConv(
             file.absolutePath,
             dest.absolutePath,
-            PinyinDictManager.MODE_BIN_TO_TXT
+            PinyinDictManager.MODE_BIN_TO_TXT,
+            null
         )
         return TextDictionary(dest)
     }
 
-    override fun toLibIMEDictionary(dest: File): LibIMEDictionary {
+    override fun toLibIMEDictionary(dest: File, listener: ProgressListener?): LibIMEDictionary {
         ensureBin(dest)
         file.copyTo(dest)
         return LibIMEDictionary(dest)
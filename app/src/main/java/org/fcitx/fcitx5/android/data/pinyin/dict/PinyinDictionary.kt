@@ -4,6 +4,7 @@
  */
 package org.fcitx.fcitx5.android.data.pinyin.dict
 
+import org.fcitx.fcitx5.android.core.ProgressListener
 import java.io.File
 
 abstract class PinyinDictionary {
@@ -29,7 +30,10 @@ abstract class PinyinDictionary {
 
     abstract fun toTextDictionary(dest: File): TextDictionary
 
-    abstract fun toLibIMEDictionary(dest: File): LibIMEDictionary
+    abstract fun toLibIMEDictionary(
+        dest: File,
+        listener: ProgressListener? = null
+    ): LibIMEDictionary
 
     open val name: String
         get() = file.nameWithoutExtension
@@ -5,6 +5,7 @@
 package org.fcitx.fcitx5.android.data.pinyin.dict
 
 import org.fcitx.fcitx5.android.R
+import org.fcitx.fcitx5.android.core.ProgressListener
 import org.fcitx.fcitx5.android.data.pinyin.PinyinDictManager
 import org.fcitx.fcitx5.android.utils.errorArg
 import java.io.File
@@ -23,15 +24,14 @@ class SougouDictionary(file: File) : PinyinDictionary() {
 
     override fun toTextDictionary(dest: File): TextDictionary {
         ensureTxt(dest)
-        PinyinDictManager.sougouDictConv(file.absolutePath, dest.absolutePath)
+        PinyinDictManager.sougouDictConv(file.absolutePath, dest.absolutePath, true, null)
         return TextDictionary(dest)
     }
 
-    override fun toLibIMEDictionary(dest: File): LibIMEDictionary {
-        val txtDict = toTextDictionary()
-        val libimeDict = txtDict.toLibIMEDictionary(dest)
-        txtDict.file.delete()
-        return libimeDict
+    override fun toLibIMEDictionary(dest: File, listener: ProgressListener?): LibIMEDictionary {
+        ensureBin(dest)
+        PinyinDictManager.sougouDictConv(file.absolutePath, dest.absolutePath, false, listener)
+        return LibIMEDictionary(dest)
     }
 
 }
\ No newline at end of file
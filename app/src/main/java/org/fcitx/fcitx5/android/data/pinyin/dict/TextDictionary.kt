@@ -5,6 +5,7 @@
 package org.fcitx.fcitx5.android.data.pinyin.dict
 
 import org.fcitx.fcitx5.android.R
+import org.fcitx.fcitx5.android.core.ProgressListener
 import org.fcitx.fcitx5.android.data.pinyin.PinyinDictManager
 import org.fcitx.fcitx5.android.utils.errorArg
 import java.io.File
@@ -27,12 +28,13 @@ class TextDictionary(file: File) : PinyinDictionary() {
         return TextDictionary(dest)
     }
 
-    override fun toLibIMEDictionary(dest: File): LibIMEDictionary {
+    override fun toLibIMEDictionary(dest: File, listener: ProgressListener?): LibIMEDictionary {
         ensureBin(dest)
         PinyinDictManager.pinyinDictConv(
             file.absolutePath,
             dest.absolutePath,
-            PinyinDictManager.MODE_TXT_TO_BIN
+            PinyinDictManager.MODE_TXT_TO_BIN,
+            listener
         )
         return LibIMEDictionary(dest)
     }
@@ -4,13 +4,21 @@
  */
 package org.fcitx.fcitx5.android.data.table
 
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.launch
+import kotlinx.coroutines.withContext
+import org.fcitx.fcitx5.android.FcitxApplication
 import org.fcitx.fcitx5.android.R
+import org.fcitx.fcitx5.android.core.ProgressListener
+import org.fcitx.fcitx5.android.daemon.FcitxDaemon
 import org.fcitx.fcitx5.android.data.table.dict.Dictionary
 import org.fcitx.fcitx5.android.data.table.dict.LibIMEDictionary
 import org.fcitx.fcitx5.android.utils.appContext
 import org.fcitx.fcitx5.android.utils.errorRuntime
 import org.fcitx.fcitx5.android.utils.extract
+import org.fcitx.fcitx5.android.utils.toast
 import org.fcitx.fcitx5.android.utils.withTempDir
+import timber.log.Timber
 import java.io.File
 import java.io.InputStream
 import java.util.zip.ZipInputStream
@@ -36,7 +44,13 @@ object TableManager {
             }.getOrNull()
         } ?: emptyList()
 
-    fun importFromZip(src: InputStream): Result<TableBasedInputMethod> =
+    /**
+     * @param listener receives progress of dictionary conversion, and may cancel it by returning false
+     */
+    fun importFromZip(
+        src: InputStream,
+        listener: ProgressListener? = null
+    ): Result<TableBasedInputMethod> =
         runCatching {
             ZipInputStream(src).use { zipStream ->
                 withTempDir { tempDir ->
@@ -47,7 +61,7 @@ object TableManager {
                     val dictFile = extracted.find { it.name.endsWith(".dict") }
                         ?: extracted.find { it.name.endsWith(".txt") }
                         ?: errorRuntime(R.string.exception_table)
-                    importFiles(confFile, dictFile)
+                    importFiles(confFile, dictFile, listener)
                 }
             }
         }
@@ -56,7 +70,8 @@ object TableManager {
         confName: String,
         confStream: InputStream,
         dictName: String,
-        dictStream: InputStream
+        dictStream: InputStream,
+        listener: ProgressListener? = null
     ): Result<TableBasedInputMethod> = runCatching {
         withTempDir { tempDir ->
             val confFile = File(tempDir, confName).also {
@@ -65,11 +80,15 @@ object TableManager {
             val dictFile = File(tempDir, dictName).also {
                 it.outputStream().use { o -> dictStream.use { i -> i.copyTo(o) } }
             }
-            importFiles(confFile, dictFile)
+            importFiles(confFile, dictFile, listener)
         }
     }
 
-    private fun importFiles(confFile: File, dictFile: File): TableBasedInputMethod {
+    private fun importFiles(
+        confFile: File,
+        dictFile: File,
+        listener: ProgressListener?
+    ): TableBasedInputMethod {
         val importedConfFile = File(inputMethodDir, confFile.name.removeSuffix(".in")).also {
             if (it.exists())
                 errorRuntime(R.string.table_already_exists, it.name)
@@ -84,19 +103,24 @@ object TableManager {
         val table = Dictionary.new(dictFile)!!
         im.tableFileName = TableBasedInputMethod.fixedTableFileName(table.name)
         runCatching {
-            im.table = table.toLibIMEDictionary(File(tableDicDir, im.tableFileName))
+            im.table = table.toLibIMEDictionary(File(tableDicDir, im.tableFileName), listener)
         }.onFailure {
             im.file.delete()
             errorRuntime(R.string.invalid_table_dict, it.message)
         }
         im.save()
+        if (table is LibIMEDictionary) {
+            // remove the input method again if its dictionary turns out to be broken
+            deepCheckInBackground(im.table!!.file, onFailure = { im.delete() })
+        }
         return im
     }
 
     fun replaceTableDict(
         im: TableBasedInputMethod,
         dictName: String,
-        dictStream: InputStream
+        dictStream: InputStream,
+        listener: ProgressListener? = null
     ): Result<LibIMEDictionary> = runCatching {
         withTempDir { tempDir ->
             val dictFile = File(tempDir, dictName).also {
@@ -104,9 +128,22 @@ object TableManager {
             }
             val dict = Dictionary.new(dictFile)!!
             runCatching {
-                dict.toLibIMEDictionary(File(tempDir, im.tableFileName))
+                dict.toLibIMEDictionary(File(tempDir, im.tableFileName), listener)
             }.onSuccess {
-                it.file.copyTo(File(tableDicDir, im.tableFileName), overwrite = true)
+                val dest = File(tableDicDir, im.tableFileName)
+                if (dict is LibIMEDictionary) {
+                    // keep previous dictionary until the new one passes deep check
+                    val backup = File(tableDicDir, "${im.tableFileName}.bak")
+                    if (dest.exists()) dest.copyTo(backup, overwrite = true)
+                    it.file.copyTo(dest, overwrite = true)
+                    deepCheckInBackground(
+                        dest,
+                        onSuccess = { backup.delete() },
+                        onFailure = { if (!backup.renameTo(dest)) dest.delete() }
+                    )
+                } else {
+                    it.file.copyTo(dest, overwrite = true)
+                }
             }.onFailure {
                 dictFile.delete()
                 errorRuntime(R.string.invalid_table_dict, it.message)
@@ -114,11 +151,53 @@ object TableManager {
         }
     }
 
+    /**
+     * Binary dictionaries imported as-is only had their header checked,
+     * fully load them in background. If it fails, undo the import with [onFailure],
+     * restart fcitx so that it no longer uses the broken dictionary, and warn the user.
+     */
+    private fun deepCheckInBackground(
+        file: File,
+        onSuccess: () -> Unit = {},
+        onFailure: () -> Unit
+    ) {
+        val app = FcitxApplication.getInstance()
+        app.coroutineScope.launch(Dispatchers.IO) {
+            runCatching {
+                checkTableDictFormat(file.absolutePath, deep = true)
+            }.onSuccess {
+                onSuccess()
+            }.onFailure {
+                Timber.w("Deep check of ${file.name} failed: ${it.message}")
+                onFailure()
+                FcitxDaemon.restartFcitx()
+                withContext(Dispatchers.Main) {
+                    app.toast(app.getString(R.string.invalid_table_dict, it.message))
+                }
+            }
+        }
+    }
+
+    /**
+     * @param listener receives progress in bytes of [src], and may cancel it by returning false
+     */
     @JvmStatic
-    external fun tableDictConv(src: String, dest: String, mode: Boolean)
+    external fun tableDictConv(
+        src: String,
+        dest: String,
+        mode: Boolean,
+        listener: ProgressListener?
+    )
 
+    /**
+     * @param deep load the whole dictionary, instead of only checking its header
+     */
     @JvmStatic
-    external fun checkTableDictFormat(src: String, user: Boolean = false): Boolean
+    external fun checkTableDictFormat(
+        src: String,
+        user: Boolean = false,
+        deep: Boolean = false
+    ): Boolean
 
     const val MODE_BIN_TO_TXT = true
     const val MODE_TXT_TO_BIN = false
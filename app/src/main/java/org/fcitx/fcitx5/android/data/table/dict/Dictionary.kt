@@ -4,6 +4,7 @@
  */
 package org.fcitx.fcitx5.android.data.table.dict
 
+import org.fcitx.fcitx5.android.core.ProgressListener
 import java.io.File
 
 abstract class Dictionary {
@@ -25,9 +26,18 @@ abstract class Dictionary {
 
     abstract val type: Type
 
-    abstract fun toTextDictionary(dest: File): TextDictionary
-
-    abstract fun toLibIMEDictionary(dest: File): LibIMEDictionary
+    /**
+     * @param listener receives progress in bytes of [file], and may cancel it by returning false
+     */
+    abstract fun toTextDictionary(dest: File, listener: ProgressListener? = null): TextDictionary
+
+    /**
+     * @param listener receives progress in bytes of [file], and may cancel it by returning false
+     */
+    abstract fun toLibIMEDictionary(
+        dest: File,
+        listener: ProgressListener? = null
+    ): LibIMEDictionary
 
     open val name: String
         get() = file.nameWithoutExtension
@@ -5,6 +5,7 @@
 package org.fcitx.fcitx5.android.data.table.dict
 
 import org.fcitx.fcitx5.android.R
+import org.fcitx.fcitx5.android.core.ProgressListener
 import org.fcitx.fcitx5.android.data.table.TableManager
 import org.fcitx.fcitx5.android.utils.errorArg
 import java.io.File
@@ -22,18 +23,19 @@ class TextDictionary(file: File) : Dictionary() {
             errorArg(R.string.exception_text_dict_filename, file.name)
     }
 
-    override fun toTextDictionary(dest: File): TextDictionary {
+    override fun toTextDictionary(dest: File, listener: ProgressListener?): TextDictionary {
         ensureTxt(dest)
         file.copyTo(dest)
         return TextDictionary(dest)
     }
 
-    override fun toLibIMEDictionary(dest: File): LibIMEDictionary {
+    override fun toLibIMEDictionary(dest: File, listener: ProgressListener?): LibIMEDictionary {
         ensureBin(dest)
         TableManager.tableDictConv(
             file.absolutePath,
             dest.absolutePath,
-            TableManager.MODE_TXT_TO_BIN
+            TableManager.MODE_TXT_TO_BIN,
+            listener
         )
         return LibIMEDictionary(dest)
     }
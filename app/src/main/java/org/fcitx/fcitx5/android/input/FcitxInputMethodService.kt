@@ -43,6 +43,7 @@ import kotlinx.coroutines.channels.Channel
 import kotlinx.coroutines.channels.consumeEach
 import kotlinx.coroutines.launch
 import org.fcitx.fcitx5.android.R
+import org.fcitx.fcitx5.android.core.CapabilityFlag
 import org.fcitx.fcitx5.android.core.CapabilityFlags
 import org.fcitx.fcitx5.android.core.FcitxAPI
 import org.fcitx.fcitx5.android.core.FcitxEvent
@@ -227,6 +228,8 @@ class FcitxInputMethodService : LifecycleInputMethodService() {
 
     private fun handleDeleteSurrounding(before: Int, after: Int) {
         val ic = currentInputConnection ?: return
+        // text after cursor may be deleted without moving cursor
+        invalidateSurroundingText()
         if (before > 0) {
             selection.predictOffset(-before)
         }
@@ -473,14 +476,14 @@ class FcitxInputMethodService : LifecycleInputMethodService() {
         // skip \n, because fcitx wants \r for return
         if (charCode > 0 && charCode != '\t'.code && charCode != '\n'.code) {
             postFcitxJob {
-                sendKey(charCode, states.states, up, timestamp)
+                sendKey(charCode, states.states, up, timestamp, event.eventTime)
             }
             return true
         }
         val keySym = KeySym.fromKeyEvent(event)
         if (keySym != null) {
             postFcitxJob {
-                sendKey(keySym, states, up, timestamp)
+                sendKey(keySym, states, up, timestamp, event.eventTime)
             }
             return true
         }
@@ -556,6 +559,7 @@ class FcitxInputMethodService : LifecycleInputMethodService() {
         // right cursor position, try to workaround this would simply introduce more bugs.
         selection.resetTo(attribute.initialSelStart, attribute.initialSelEnd)
         resetComposingState()
+        invalidateSurroundingText()
         val flags = CapabilityFlags.fromEditorInfo(attribute)
         capabilityFlags = flags
         Timber.d("onStartInput: initialSel=${selection.current}, restarting=$restarting")
@@ -604,6 +608,8 @@ class FcitxInputMethodService : LifecycleInputMethodService() {
 
     private fun handleCursorUpdate(newSelStart: Int, newSelEnd: Int, updateIndex: Int) {
         if (selection.consume(newSelStart, newSelEnd)) {
+            // cursor moved by our own edit, editor content has changed
+            invalidateSurroundingText()
             return // do nothing if prediction matches
         } else {
             // cursor update can't match any prediction: it's treated as a user input
@@ -613,14 +619,19 @@ class FcitxInputMethodService : LifecycleInputMethodService() {
         if (newSelStart != newSelEnd) return
         // do reset if composing is empty && input panel is not empty
         if (composing.isEmpty()) {
+            val surrounding = surroundingTextAroundCursor(newSelStart)
             postFcitxJob {
                 if (!isEmpty()) {
                     Timber.d("handleCursorUpdate: reset")
                     reset()
                 }
+                if (updateIndex != cursorUpdateIndex) return@postFcitxJob
+                // let input method rebuild the word around cursor
+                surrounding?.let { (text, cursor) -> setSurroundingText(text, cursor) }
             }
             return
         }
+        invalidateSurroundingText()
         // check if cursor inside composing text
         if (composing.contains(newSelStart)) {
             if (ignoreSystemCursor) return
@@ -650,6 +661,59 @@ class FcitxInputMethodService : LifecycleInputMethodService() {
         }
     }
 
+    /**
+     * Text around cursor that has been read from editor, reused while user moves cursor inside it,
+     * so that editor is not queried on every cursor move, and fcitx receives the same text
+     * (only cursor differs) to update the word around cursor incrementally.
+     * [surroundingStart] is its position in editor, or -1 if editor content may have changed since.
+     */
+    private var surroundingText = ""
+    private var surroundingStart = -1
+    private var surroundingReachesEnd = false
+
+    private fun invalidateSurroundingText() {
+        surroundingStart = -1
+    }
+
+    /**
+     * @return text around cursor and cursor position in code points,
+     * or null if current input method does not make use of it
+     */
+    private fun surroundingTextAroundCursor(cursor: Int): Pair<String, Int>? {
+        if (capabilityFlags.has(CapabilityFlag.Password)) return null
+        if (fcitx.runImmediately { inputMethodEntryCached }.addon != "androidkeyboard") return null
+        val start = surroundingStart
+        val end = start + surroundingText.length
+        val cached = start >= 0 &&
+                (start == 0 || cursor - start >= SurroundingTextMargin) &&
+                (surroundingReachesEnd || end - cursor >= SurroundingTextMargin) &&
+                cursor in start..end
+        if (!cached && !readSurroundingText(cursor)) return null
+        return surroundingText to Character.codePointCount(surroundingText, 0, cursor - surroundingStart)
+    }
+
+    private fun readSurroundingText(cursor: Int): Boolean {
+        val ic = currentInputConnection ?: return false
+        val before: Int
+        val after: Int
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.S) {
+            val text = ic.getSurroundingText(SurroundingTextWindow, SurroundingTextWindow, 0)
+                ?: return false
+            surroundingText = text.text.toString()
+            before = text.selectionStart
+            after = surroundingText.length - text.selectionEnd
+        } else {
+            val textBefore = ic.getTextBeforeCursor(SurroundingTextWindow, 0) ?: return false
+            val textAfter = ic.getTextAfterCursor(SurroundingTextWindow, 0) ?: return false
+            surroundingText = "$textBefore$textAfter"
+            before = textBefore.length
+            after = textAfter.length
+        }
+        surroundingStart = cursor - before
+        surroundingReachesEnd = after < SurroundingTextWindow
+        return surroundingStart >= 0
+    }
+
     // because setComposingText(text, cursor) can only put cursor at end of composing,
     // sometimes onUpdateCursorAnchorInfo/onUpdateSelection would receive event with wrong cursor position.
     // those events need to be filtered.
@@ -830,6 +894,11 @@ class FcitxInputMethodService : LifecycleInputMethodService() {
 
     companion object {
         const val DeleteSurroundingFlag = "org.fcitx.fcitx5.android.DELETE_SURROUNDING"
+
+        private const val SurroundingTextWindow = 64
+
+        // read again if cursor gets closer than this to the edge of text read before
+        private const val SurroundingTextMargin = 16
     }
 
 }
\ No newline at end of file
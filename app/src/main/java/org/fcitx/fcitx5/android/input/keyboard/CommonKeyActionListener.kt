@@ -4,6 +4,7 @@
  */
 package org.fcitx.fcitx5.android.input.keyboard
 
+import android.os.SystemClock
 import androidx.core.content.ContextCompat
 import androidx.lifecycle.lifecycleScope
 import kotlinx.coroutines.launch
@@ -91,11 +92,18 @@ class CommonKeyActionListener :
     val listener by lazy {
         KeyActionListener { action, _ ->
             when (action) {
-                is FcitxKeyAction -> service.postFcitxJob {
-                    sendKey(action.act, KeyState.Virtual.state)
+                is FcitxKeyAction -> {
+                    // taken before the job is queued, so that dispatch latency includes the wait
+                    val eventTime = SystemClock.uptimeMillis()
+                    service.postFcitxJob {
+                        sendKey(action.act, KeyState.Virtual.state, eventTime = eventTime)
+                    }
                 }
-                is SymAction -> service.postFcitxJob {
-                    sendKey(action.sym, action.states)
+                is SymAction -> {
+                    val eventTime = SystemClock.uptimeMillis()
+                    service.postFcitxJob {
+                        sendKey(action.sym, action.states, eventTime = eventTime)
+                    }
                 }
                 is CommitAction -> service.postFcitxJob {
                     commitAndReset()
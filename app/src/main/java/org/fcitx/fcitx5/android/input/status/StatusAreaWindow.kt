@@ -44,6 +44,7 @@ import splitties.views.dsl.core.horizontalLayout
 import splitties.views.dsl.core.lParams
 import splitties.views.dsl.recyclerview.recyclerView
 import splitties.views.recyclerview.gridLayoutManager
+import timber.log.Timber
 
 class StatusAreaWindow : InputWindow.ExtendedInputWindow<StatusAreaWindow>(),
     InputBroadcastReceiver {
@@ -142,7 +143,15 @@ class StatusAreaWindow : InputWindow.ExtendedInputWindow<StatusAreaWindow>(),
                             )
                         }
                         ReloadConfig -> fcitx.launchOnReady { f ->
-                            f.reloadConfig()
+                            val reloaded = f.reloadChangedConfig()
+                            if (reloaded.isEmpty()) {
+                                // user asked for a reload, maybe because of a change that cannot be seen from files
+                                f.reloadConfig()
+                            } else {
+                                reloaded.forEach {
+                                    Timber.d("Reloaded ${it.target} in ${it.durationMicros}us")
+                                }
+                            }
                             if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.UPSIDE_DOWN_CAKE) {
                                 SubtypeManager.syncWith(f.enabledIme())
                             }
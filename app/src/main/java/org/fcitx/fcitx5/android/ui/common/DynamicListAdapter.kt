@@ -196,6 +196,17 @@ abstract class DynamicListAdapter<T>(
         mainViewModel?.showToolbarEditButton()
     }
 
+    /**
+     * Append entries that have been loaded lazily, they are not changes made by user,
+     * so listeners are not notified.
+     */
+    fun appendItems(items: Collection<T>) {
+        if (items.isEmpty()) return
+        val start = _entries.size
+        _entries.addAll(items)
+        notifyItemRangeInserted(start, items.size)
+    }
+
     @CallSuper
     open fun removeItem(idx: Int): T {
         val item = _entries.removeAt(idx)
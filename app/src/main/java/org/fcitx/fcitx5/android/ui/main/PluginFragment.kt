@@ -49,8 +49,8 @@ class PluginFragment : PaddingPreferenceFragment() {
                         // we only check new plugins on the first creation
                         preferenceScreen = createPreferenceScreen(false)
                     }
-                    // DataManager.sync and and restart fcitx
-                    FcitxDaemon.restartFcitx()
+                    // DataManager.sync and load new plugins, or restart fcitx
+                    FcitxDaemon.reloadPlugins()
                 }
             }
             val loaded = DataManager.getLoadedPlugins()
@@ -15,9 +15,14 @@ import android.view.inputmethod.EditorInfo
 import androidx.fragment.app.Fragment
 import androidx.fragment.app.activityViewModels
 import androidx.lifecycle.lifecycleScope
+import androidx.recyclerview.widget.LinearLayoutManager
+import androidx.recyclerview.widget.RecyclerView
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.NonCancellable
 import kotlinx.coroutines.launch
+import kotlinx.coroutines.sync.Mutex
+import kotlinx.coroutines.sync.withLock
+import kotlinx.coroutines.withContext
 import org.fcitx.fcitx5.android.R
 import org.fcitx.fcitx5.android.core.reloadPinyinCustomPhrase
 import org.fcitx.fcitx5.android.data.pinyin.CustomPhraseManager
@@ -45,7 +50,35 @@ class PinyinCustomPhraseFragment : Fragment(), OnItemChangedListener<PinyinCusto
 
     private val dustman = NaiveDustman<PinyinCustomPhrase>()
 
-    private val initialItems = CustomPhraseManager.load() ?: emptyArray()
+    private val initialItems = if (CustomPhraseManager.open()) {
+        CustomPhraseManager.get(0, PAGE_SIZE) ?: emptyArray()
+    } else {
+        emptyArray()
+    }
+
+    /**
+     * phrases as they are in native store, by id, only those loaded or added in this editor
+     */
+    private val committedItems = initialItems.associateByTo(mutableMapOf()) { it.id }
+
+    /**
+     * serializes paging with saving, since saving shifts phrases in native store
+     */
+    private val storeMutex = Mutex()
+
+    private var totalCount = CustomPhraseManager.count()
+
+    /**
+     * offset of next page in native store
+     */
+    private var loadedCount = initialItems.size
+
+    /**
+     * pages are in ascending order of id, so phrases up to this id have been paged through
+     */
+    private var lastLoadedId = initialItems.lastOrNull()?.id ?: -1
+
+    private var loadingPage = false
 
     private var keyLabel = KEY
     private var orderLabel = ORDER
@@ -77,6 +110,17 @@ class PinyinCustomPhraseFragment : Fragment(), OnItemChangedListener<PinyinCusto
                 }
             }
         ) {
+            init {
+                recyclerView.addOnScrollListener(object : RecyclerView.OnScrollListener() {
+                    override fun onScrolled(recyclerView: RecyclerView, dx: Int, dy: Int) {
+                        val layoutManager = recyclerView.layoutManager as LinearLayoutManager
+                        if (layoutManager.findLastVisibleItemPosition() >= layoutManager.itemCount - PAGE_SIZE / 2) {
+                            loadNextPage()
+                        }
+                    }
+                })
+            }
+
             override fun showEntry(x: PinyinCustomPhrase): String {
                 val s = x.serialize()
                 val firstLF = s.indexOf('\n')
@@ -153,7 +197,7 @@ class PinyinCustomPhraseFragment : Fragment(), OnItemChangedListener<PinyinCusto
                         } else {
                             phraseField.error = null
                         }
-                        block(PinyinCustomPhrase(key, order, phrase))
+                        block(PinyinCustomPhrase(key, order, phrase, entry?.id ?: -1))
                         return@onClick true
                     }
             }
@@ -185,17 +229,73 @@ class PinyinCustomPhraseFragment : Fragment(), OnItemChangedListener<PinyinCusto
         dustman.addOrUpdate(new.serialize(), new)
     }
 
+    private fun loadNextPage() {
+        if (loadingPage || loadedCount >= totalCount) return
+        loadingPage = true
+        lifecycleScope.launch {
+            storeMutex.withLock {
+                val offset = loadedCount
+                val page = withContext(Dispatchers.IO) {
+                    CustomPhraseManager.get(offset, PAGE_SIZE)
+                } ?: emptyArray()
+                loadedCount = if (page.isEmpty()) totalCount else offset + page.size
+                page.lastOrNull()?.let { lastLoadedId = it.id }
+                // phrases added in this editor are appended to native store, and already in list
+                val fresh = page.filter { it.id !in committedItems }
+                fresh.associateByTo(committedItems) { it.id }
+                dustman.addInitial(fresh.associateBy { it.serialize() })
+                ui.appendItems(fresh)
+            }
+            loadingPage = false
+        }
+    }
+
     private fun saveConfig() {
         if (!dustman.dirty) return
+        val entries = ui.entries
+        val kept = entries.mapNotNullTo(mutableSetOf()) { it.id.takeIf { id -> id >= 0 } }
+        val removed = committedItems.keys.filter { it !in kept }
+        val updated = entries.filter { it.id >= 0 && committedItems[it.id] != it }
+        val added = entries.filter { it.id < 0 }
         resetDustman()
         lifecycleScope.launch(NonCancellable + Dispatchers.IO) {
-            CustomPhraseManager.save(ui.entries.toTypedArray())
+            storeMutex.withLock {
+                saveToStore(removed, updated, added)
+            }
             viewModel.fcitx.runOnReady {
                 reloadPinyinCustomPhrase()
             }
         }
     }
 
+    private suspend fun saveToStore(
+        removed: List<Int>,
+        updated: List<PinyinCustomPhrase>,
+        added: List<PinyinCustomPhrase>
+    ) {
+        val addedIds = CustomPhraseManager.edit(
+            removed.toIntArray(),
+            updated.toTypedArray(),
+            added.toTypedArray()
+        ) ?: IntArray(added.size) { -1 }
+        val total = CustomPhraseManager.count()
+        withContext(Dispatchers.Main) {
+            // removed phrases that have been paged through no longer shift next page
+            loadedCount -= removed.count { it <= lastLoadedId }
+            totalCount = total
+            removed.forEach { committedItems.remove(it) }
+            updated.forEach { committedItems[it.id] = it }
+            added.forEachIndexed { i, old ->
+                if (addedIds[i] < 0) return@forEachIndexed
+                val new = old.copy(id = addedIds[i])
+                committedItems[new.id] = new
+                // by identity, since identical phrases added twice are equal but occupy different rows
+                ui.entries.indexOfFirst { it === old }.takeIf { it >= 0 }?.let { ui.updateItem(it, new) }
+            }
+            resetDustman()
+        }
+    }
+
     private fun resetDustman() {
         dustman.reset(ui.entries.associateBy { it.serialize() })
     }
@@ -231,6 +331,7 @@ class PinyinCustomPhraseFragment : Fragment(), OnItemChangedListener<PinyinCusto
         const val ORDER = "Order"
         const val PHRASE = "Phrase"
         const val MANAGE_CUSTOM_PHRASE = "Manage Custom Phrase"
+        const val PAGE_SIZE = 200
     }
 
 }
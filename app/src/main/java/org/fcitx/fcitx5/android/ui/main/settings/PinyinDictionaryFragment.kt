@@ -36,6 +36,7 @@ import org.fcitx.fcitx5.android.utils.importErrorDialog
 import org.fcitx.fcitx5.android.utils.notificationManager
 import org.fcitx.fcitx5.android.utils.parcelable
 import org.fcitx.fcitx5.android.utils.queryFileName
+import java.io.File
 import java.util.concurrent.atomic.AtomicBoolean
 
 class PinyinDictionaryFragment : Fragment(), OnItemChangedListener<PinyinDictionary> {
@@ -106,7 +107,7 @@ class PinyinDictionaryFragment : Fragment(), OnItemChangedListener<PinyinDiction
 
     override fun onViewCreated(view: View, savedInstanceState: Bundle?) {
         arguments?.parcelable<Uri>(INTENT_DATA_URI)
-            ?.let { importFromUri(it) }
+            ?.let { importFromUris(listOf(it)) }
         super.onViewCreated(view, savedInstanceState)
     }
 
@@ -122,46 +123,60 @@ class PinyinDictionaryFragment : Fragment(), OnItemChangedListener<PinyinDiction
     }
 
     private fun registerLauncher() {
-        launcher = registerForActivityResult(ActivityResultContracts.GetContent()) { uri ->
-            if (uri != null)
-                importFromUri(uri)
+        launcher = registerForActivityResult(ActivityResultContracts.GetMultipleContents()) { uris ->
+            if (uris.isNotEmpty())
+                importFromUris(uris)
         }
     }
 
-    private fun importFromUri(uri: Uri) {
+    private fun importFromUris(uris: List<Uri>) {
         val ctx = requireContext()
         val cr = ctx.contentResolver
         val nm = ctx.notificationManager
         lifecycleScope.launch(NonCancellable + Dispatchers.IO) {
             val id = IMPORT_ID++
-            val fileName = cr.queryFileName(uri) ?: return@launch
-            if (PinyinDictionary.Type.fromFileName(fileName) == null) {
+            val fileNames = uris.map { cr.queryFileName(it) ?: return@launch }
+            if (fileNames.any { PinyinDictionary.Type.fromFileName(it) == null }) {
                 ctx.importErrorDialog(R.string.invalid_dict)
                 return@launch
             }
-            val entryName = fileName.substringBeforeLast('.')
-            if (ui.entries.any { it.name == entryName }) {
+            val entryNames = fileNames.map { it.substringBeforeLast('.') }
+            if (entryNames.toSet().size != entryNames.size ||
+                ui.entries.any { it.name in entryNames }
+            ) {
                 ctx.importErrorDialog(R.string.dict_already_exists)
                 return@launch
             }
-            NotificationCompat.Builder(ctx, CHANNEL_ID)
+            val entryName = entryNames.joinToString()
+            val builder = NotificationCompat.Builder(ctx, CHANNEL_ID)
                 .setSmallIcon(R.drawable.ic_baseline_library_books_24)
                 .setContentTitle(getString(R.string.pinyin_dict))
                 .setContentText("${getString(R.string.importing)} $entryName")
                 .setOngoing(true)
                 .setProgress(100, 0, true)
                 .setPriority(NotificationCompat.PRIORITY_HIGH)
-                .build().let { nm.notify(id, it) }
+            nm.notify(id, builder.build())
+            val tempFiles = fileNames.map { File(ctx.cacheDir, it) }
             try {
-                val inputStream = cr.openInputStream(uri)!!
-                val imported = PinyinDictManager.importFromInputStream(inputStream, fileName)
-                    .getOrThrow()
+                uris.zip(tempFiles) { uri, file ->
+                    cr.openInputStream(uri)!!.use { input ->
+                        file.outputStream().use { input.copyTo(it) }
+                    }
+                }
+                val imported = PinyinDictManager.importFromFiles(tempFiles) { processed, total ->
+                    if (total > 0) {
+                        builder.setProgress(100, (processed * 100 / total).toInt(), false)
+                        nm.notify(id, builder.build())
+                    }
+                    true
+                }.getOrThrow()
                 withContext(Dispatchers.Main) {
-                    ui.addItem(item = imported)
+                    imported.forEach { ui.addItem(item = it) }
                 }
             } catch (e: Exception) {
                 ctx.importErrorDialog(e)
             }
+            tempFiles.forEach { it.delete() }
             nm.cancel(id)
         }
     }
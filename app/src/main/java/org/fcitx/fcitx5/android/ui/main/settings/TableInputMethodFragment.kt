@@ -24,6 +24,8 @@ import kotlinx.coroutines.NonCancellable
 import kotlinx.coroutines.launch
 import kotlinx.coroutines.withContext
 import org.fcitx.fcitx5.android.R
+import org.fcitx.fcitx5.android.core.ProgressListener
+import org.fcitx.fcitx5.android.core.SubtypeManager
 import org.fcitx.fcitx5.android.daemon.FcitxDaemon
 import org.fcitx.fcitx5.android.data.table.TableBasedInputMethod
 import org.fcitx.fcitx5.android.data.table.TableManager
@@ -216,17 +218,20 @@ class TableInputMethodFragment : Fragment(), OnItemChangedListener<TableBasedInp
                 ctx.importErrorDialog(R.string.exception_table_im_filename, fileName)
                 return@launch
             }
-            NotificationCompat.Builder(ctx, CHANNEL_ID)
+            val builder = NotificationCompat.Builder(ctx, CHANNEL_ID)
                 .setSmallIcon(R.drawable.ic_baseline_library_books_24)
                 .setContentTitle(getString(R.string.table_im))
                 .setContentText("${getString(R.string.importing)} $fileName")
                 .setOngoing(true)
                 .setProgress(100, 0, true)
                 .setPriority(NotificationCompat.PRIORITY_HIGH)
-                .build().let { nm.notify(importId, it) }
+            nm.notify(importId, builder.build())
             try {
                 val inputStream = cr.openInputStream(uri)!!
-                val imported = TableManager.importFromZip(inputStream).getOrThrow()
+                val imported = TableManager.importFromZip(
+                    inputStream,
+                    progressListener(nm, importId, builder)
+                ).getOrThrow()
                 withContext(Dispatchers.Main) {
                     ui.addItem(item = imported)
                 }
@@ -281,23 +286,24 @@ class TableInputMethodFragment : Fragment(), OnItemChangedListener<TableBasedInp
             val importId = IMPORT_ID++
             val confName = cr.queryFileName(confUri) ?: return@launch
             val dictName = cr.queryFileName(dictUri) ?: return@launch
-            NotificationCompat.Builder(ctx, CHANNEL_ID)
+            val builder = NotificationCompat.Builder(ctx, CHANNEL_ID)
                 .setSmallIcon(R.drawable.ic_baseline_library_books_24)
                 .setContentTitle(getString(R.string.table_im))
                 .setContentText("${getString(R.string.importing)} $confName")
                 .setOngoing(true)
                 .setProgress(100, 0, true)
                 .setPriority(NotificationCompat.PRIORITY_HIGH)
-                .build().let { nm.notify(importId, it) }
+            nm.notify(importId, builder.build())
             try {
                 val confStream = cr.openInputStream(confUri)!!
                 val dictStream = cr.openInputStream(dictUri)!!
                 withContext(Dispatchers.Main) {
                     updateFilesSelectionDialogButton(importing = true)
                 }
-                val imported =
-                    TableManager.importFromConfAndDict(confName, confStream, dictName, dictStream)
-                        .getOrThrow()
+                val imported = TableManager.importFromConfAndDict(
+                    confName, confStream, dictName, dictStream,
+                    progressListener(nm, importId, builder)
+                ).getOrThrow()
                 withContext(Dispatchers.Main) {
                     dismissFilesSelectionDialog()
                     ui.addItem(item = imported)
@@ -325,17 +331,20 @@ class TableInputMethodFragment : Fragment(), OnItemChangedListener<TableBasedInp
                 ctx.importErrorDialog(R.string.exception_table_dict_filename, dictName)
                 return@launch
             }
-            NotificationCompat.Builder(ctx, CHANNEL_ID)
+            val builder = NotificationCompat.Builder(ctx, CHANNEL_ID)
                 .setSmallIcon(R.drawable.ic_baseline_library_books_24)
                 .setContentTitle(getString(R.string.table_im))
                 .setContentText("${getString(R.string.importing)} $dictName")
                 .setOngoing(true)
                 .setProgress(100, 0, true)
                 .setPriority(NotificationCompat.PRIORITY_HIGH)
-                .build().let { nm.notify(importId, it) }
+            nm.notify(importId, builder.build())
             try {
                 val dictStream = cr.openInputStream(uri)!!
-                im.table = TableManager.replaceTableDict(im, dictName, dictStream).getOrThrow()
+                im.table = TableManager.replaceTableDict(
+                    im, dictName, dictStream,
+                    progressListener(nm, importId, builder)
+                ).getOrThrow()
                 withContext(Dispatchers.Main) {
                     ui.updateItem(ui.indexItem(im), im)
                 }
@@ -347,6 +356,21 @@ class TableInputMethodFragment : Fragment(), OnItemChangedListener<TableBasedInp
         }
     }
 
+    /**
+     * show progress of dictionary conversion in the importing notification
+     */
+    private fun progressListener(
+        nm: NotificationManager,
+        id: Int,
+        builder: NotificationCompat.Builder
+    ) = ProgressListener { processed, total ->
+        if (total > 0) {
+            builder.setProgress(100, (processed * 100 / total).toInt(), false)
+            nm.notify(id, builder.build())
+        }
+        true
+    }
+
     private fun showReplaceTableDialog(im: TableBasedInputMethod) {
         AlertDialog.Builder(requireContext())
             .setTitle(R.string.update_table)
@@ -370,10 +394,26 @@ class TableInputMethodFragment : Fragment(), OnItemChangedListener<TableBasedInp
             .show()
     }
 
+    /**
+     * whether an input method has been removed since last reload
+     */
+    private var removedAny = false
+
     private fun reloadConfig() {
         if (!dustman.dirty) return
         resetDustman()
-        FcitxDaemon.restartFcitx()
+        if (removedAny) {
+            // refreshing input methods only picks up new ones, fcitx still needs a restart to drop removed ones
+            removedAny = false
+            FcitxDaemon.restartFcitx()
+            return
+        }
+        viewModel.fcitx.launchOnReady { f ->
+            f.reloadChangedConfig()
+            if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.UPSIDE_DOWN_CAKE) {
+                SubtypeManager.syncWith(f.enabledIme())
+            }
+        }
     }
 
     private fun resetDustman() {
@@ -387,6 +427,7 @@ class TableInputMethodFragment : Fragment(), OnItemChangedListener<TableBasedInp
     override fun onItemRemoved(idx: Int, item: TableBasedInputMethod) {
         item.delete()
         dustman.remove(item.name)
+        removedAny = true
     }
 
     override fun onItemUpdated(idx: Int, old: TableBasedInputMethod, new: TableBasedInputMethod) {
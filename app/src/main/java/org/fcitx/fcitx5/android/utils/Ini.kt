@@ -48,11 +48,14 @@ value class Ini(val core: RawConfig) {
         private external fun readFromIni(src: String): RawConfig?
 
         @JvmStatic
-        private external fun writeAsIni(dest: String, value: RawConfig)
+        private external fun writeAsIni(dest: String, nodes: IntArray, pool: ByteArray)
 
         fun parseIniFromFile(file: File) = readFromIni(file.path)?.let { Ini(it) }
 
-        fun writeIniToFile(ini: Ini, file: File) = writeAsIni(file.path, ini.core)
+        fun writeIniToFile(ini: Ini, file: File) {
+            val (nodes, pool) = ini.core.flatten()
+            writeAsIni(file.path, nodes, pool)
+        }
     }
 
 }
\ No newline at end of file
@@ -50,6 +50,13 @@ class NaiveDustman<T> {
         updateDirtyStatus(key, initialValues.containsKey(key))
     }
 
+    /**
+     * track more initial values without resetting dirty status, e.g. when they are loaded lazily
+     */
+    fun addInitial(initial: Map<String, T>) {
+        initialValues.putAll(initial)
+    }
+
     fun reset(initial: Map<String, T>) {
         dirty = false
         dirtyStatus.clear()
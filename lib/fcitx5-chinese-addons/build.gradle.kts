@@ -16,7 +16,6 @@ android {
                     "cmake",
                     // fcitx5-chinese-addons
                     "pinyin",
-                    "scel2org5",
                     "table",
                     "chttrans",
                     "fullwidth",
@@ -40,10 +39,6 @@ android {
             libraryName = "libtable"
             // no headers
         }
-        create("scel2org5") {
-            libraryName = "libscel2org5"
-            // no headers
-        }
         val moduleHeadersPrefix = "build/headers/usr/include/Fcitx5/Module/fcitx-module"
         create("chttrans") {
             libraryName = "libchttrans"